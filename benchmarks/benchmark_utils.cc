@@ -0,0 +1,128 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "benchmark_utils.h"
+
+#include <cstdlib>
+#include <random>
+
+#ifdef WITH_JPEG
+#include <stdio.h>
+
+extern "C" {
+
+#include <jpeglib.h>
+
+}
+#endif
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace benchmarks {
+
+void StreamSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"width", "height"});
+  b->Args({640, 480});    // STREAM_640x480
+  b->Args({1280, 480});   // STREAM_1280x480
+  b->Args({1280, 720});   // STREAM_1280x720
+  b->Args({2560, 720});   // STREAM_2560x720
+  // Conversions may run on the conversion engine's threads
+  b->UseRealTime();
+}
+
+bytes_t RandomBytes(std::size_t size, std::uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 255);
+  bytes_t bytes(size);
+  for (auto&& byte : bytes) {
+    byte = static_cast<std::uint8_t>(dist(gen));
+  }
+  return bytes;
+}
+
+std::vector<std::uint16_t> RandomDepths(std::size_t size, std::uint16_t min,
+    std::uint16_t max) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dist(min, max);
+  std::vector<std::uint16_t> depths(size);
+  for (auto&& depth : depths) {
+    depth = static_cast<std::uint16_t>(dist(gen));
+  }
+  return depths;
+}
+
+bytes_t SyntheticJpeg(int width, int height) {
+#ifdef WITH_JPEG
+  // Gradients with a little noise, compress like a real scene
+  bytes_t rgb(width * height * 3);
+  bytes_t noise = RandomBytes(rgb.size());
+  for (int r = 0; r < height; ++r) {
+    for (int c = 0; c < width; ++c) {
+      std::size_t i = (r * width + c) * 3;
+      rgb[i] = (c * 255 / width + (noise[i] & 0x0f)) & 0xff;
+      rgb[i + 1] = (r * 255 / height + (noise[i + 1] & 0x0f)) & 0xff;
+      rgb[i + 2] = ((r + c) & 0xff) ^ (noise[i + 2] & 0x07);
+    }
+  }
+
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  unsigned char* buf = nullptr;
+  unsigned long size = 0;  // NOLINT
+  jpeg_mem_dest(&cinfo, &buf, &size);
+
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  // YUV 4:2:2 as the camera
+  cinfo.comp_info[0].h_samp_factor = 2;
+  cinfo.comp_info[0].v_samp_factor = 1;
+
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row = &rgb[cinfo.next_scanline * width * 3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  bytes_t jpg(buf, buf + size);
+  free(buf);
+  return jpg;
+#else
+  UNUSED(width, height);
+  return {};
+#endif
+}
+
+void SetPixelCounters(benchmark::State& state, std::size_t pixels,
+    std::size_t bytes) {
+  if (bytes > 0) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+        * bytes);
+  }
+  state.counters["time/pixel"] = benchmark::Counter(
+      static_cast<double>(pixels),
+      benchmark::Counter::kIsIterationInvariantRate
+      | benchmark::Counter::kInvert);
+}
+
+}  // namespace benchmarks
+
+MYNTEYE_END_NAMESPACE
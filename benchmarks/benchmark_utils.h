@@ -0,0 +1,52 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_BENCHMARKS_BENCHMARK_UTILS_H_
+#define MYNTEYE_BENCHMARKS_BENCHMARK_UTILS_H_
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace benchmarks {
+
+using bytes_t = std::vector<std::uint8_t>;
+
+// Args {width, height} of all stream modes, 640x480 to 2560x720
+void StreamSizes(benchmark::internal::Benchmark* b);
+
+// Random bytes, the same for the same seed
+bytes_t RandomBytes(std::size_t size, std::uint32_t seed = 1);
+
+// Random 16-bit depths in [min, max]
+std::vector<std::uint16_t> RandomDepths(std::size_t size, std::uint16_t min,
+    std::uint16_t max);
+
+// A camera like MJPG frame (YUV 4:2:2), empty if no libjpeg
+bytes_t SyntheticJpeg(int width, int height);
+
+// Reports MB/s of bytes, and time/pixel that is seconds per pixel
+void SetPixelCounters(benchmark::State& state, std::size_t pixels,
+    std::size_t bytes);
+
+}  // namespace benchmarks
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_BENCHMARKS_BENCHMARK_UTILS_H_
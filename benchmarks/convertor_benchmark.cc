@@ -0,0 +1,209 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <benchmark/benchmark.h>
+
+#include "mynteyed/device/convertor.h"
+
+#include "benchmark_utils.h"
+
+MYNTEYE_USE_NAMESPACE
+
+using namespace benchmarks;  // NOLINT
+
+namespace {
+
+// The step arguments are all 0 here, packed, unless aligned
+using convert_t = int (*)(unsigned char*, unsigned char*,
+    unsigned int, unsigned int, unsigned int, unsigned int);
+using split_t = int (*)(unsigned char*, unsigned char*,
+    unsigned int, unsigned int, unsigned int, unsigned int);
+using convert_inplace_t = void (*)(unsigned char*, unsigned int, unsigned int,
+    unsigned int);
+using mjpg_t = int (*)(unsigned char*, int, unsigned char*, unsigned int);
+using mjpg_half_t = int (*)(unsigned char*, int, unsigned char*,
+    unsigned int, unsigned int, unsigned int);
+
+// in_bpp, out_bpp: bytes per pixel; half: output left or right half only;
+// aligned: output rows aligned to 64 bytes, as Image::SetRowAlignment(64)
+void BM_Convert(benchmark::State& state, convert_t convert, int in_bpp,
+    int out_bpp, bool half, bool aligned = false) {
+  int width = state.range(0), height = state.range(1);
+  unsigned int out_width = half ? width / 2 : width;
+  unsigned int out_step = out_width * out_bpp;
+  if (aligned) out_step = (out_step + 63) & ~63u;
+  auto in = RandomBytes(width * height * in_bpp);
+  bytes_t out(out_step * height);
+  for (auto _ : state) {
+    convert(in.data(), out.data(), width, height, aligned ? out_step : 0, 0);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, out_width * height, out.size());
+}
+
+void BM_Split(benchmark::State& state, split_t split, int bpp) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width / 2 * height;
+  auto in = RandomBytes(width * height * bpp);
+  bytes_t out(pixels * bpp);
+  for (auto _ : state) {
+    split(in.data(), out.data(), width, height, 0, 0);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, pixels, out.size());
+}
+
+void BM_ConvertInplace(benchmark::State& state, convert_inplace_t convert) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width * height;
+  auto data = RandomBytes(pixels * 3);
+  for (auto _ : state) {
+    convert(data.data(), width, height, 0);
+    benchmark::DoNotOptimize(data.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, pixels, data.size());
+}
+
+// range: fixed near & far, in one pass; otherwise of the min and max
+void BM_DepthToGray(benchmark::State& state, bool range) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width * height;
+  auto depths = RandomDepths(pixels, 300, 10000);
+  auto in = reinterpret_cast<unsigned char*>(depths.data());
+  bytes_t out(pixels);
+  for (auto _ : state) {
+    if (range) {
+      DEPTH_TO_GRAY_RANGE(in, out.data(), width, height, 500, 8000);
+    } else {
+      DEPTH_TO_GRAY(in, out.data(), width, height);
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, pixels, out.size());
+}
+
+void BM_Mjpg(benchmark::State& state, mjpg_t decode, int out_bpp) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width * height;
+  auto jpg = SyntheticJpeg(width, height);
+  if (jpg.empty()) {
+    state.SkipWithError("libjpeg not found");
+    return;
+  }
+  bytes_t out(pixels * out_bpp);
+  for (auto _ : state) {
+    decode(jpg.data(), jpg.size(), out.data(), 0);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, pixels, out.size());
+}
+
+void BM_MjpgHalf(benchmark::State& state, mjpg_half_t decode, int out_bpp) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width / 2 * height;
+  auto jpg = SyntheticJpeg(width, height);
+  if (jpg.empty()) {
+    state.SkipWithError("libjpeg not found");
+    return;
+  }
+  bytes_t out(pixels * out_bpp);
+  for (auto _ : state) {
+    decode(jpg.data(), jpg.size(), out.data(), width, height, 0);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  SetPixelCounters(state, pixels, out.size());
+}
+
+}  // namespace
+
+// MJPG
+
+BENCHMARK_CAPTURE(BM_Mjpg, MJPEG_TO_RGB_LIBJPEG, MJPEG_TO_RGB_LIBJPEG, 3)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Mjpg, MJPEG_TO_RGB, MJPEG_TO_RGB, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Mjpg, MJPEG_TO_BGR, MJPEG_TO_BGR, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Mjpg, MJPEG_TO_GRAY, MJPEG_TO_GRAY, 1)
+    ->Apply(StreamSizes);
+
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_RGB_LEFT, MJPEG_TO_RGB_LEFT, 3)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_RGB_RIGHT, MJPEG_TO_RGB_RIGHT, 3)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_BGR_LEFT, MJPEG_TO_BGR_LEFT, 3)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_BGR_RIGHT, MJPEG_TO_BGR_RIGHT, 3)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_GRAY_LEFT, MJPEG_TO_GRAY_LEFT, 1)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_MjpgHalf, MJPEG_TO_GRAY_RIGHT, MJPEG_TO_GRAY_RIGHT, 1)
+    ->Apply(StreamSizes);
+
+// Split
+
+BENCHMARK_CAPTURE(BM_Split, RGB_TO_RGB_LEFT, RGB_TO_RGB_LEFT, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Split, RGB_TO_RGB_RIGHT, RGB_TO_RGB_RIGHT, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Split, RGB_TO_BGR_LEFT, RGB_TO_BGR_LEFT, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Split, RGB_TO_BGR_RIGHT, RGB_TO_BGR_RIGHT, 3)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Split, GRAY_TO_GRAY_LEFT, GRAY_TO_GRAY_LEFT, 1)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Split, GRAY_TO_GRAY_RIGHT, GRAY_TO_GRAY_RIGHT, 1)
+    ->Apply(StreamSizes);
+
+// YUYV
+
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_RGB, YUYV_TO_RGB, 2, 3, false)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_RGB_LEFT, YUYV_TO_RGB_LEFT, 2, 3, true)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_RGB_RIGHT, YUYV_TO_RGB_RIGHT, 2, 3,
+    true)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_BGR, YUYV_TO_BGR, 2, 3, false)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_BGR_LEFT, YUYV_TO_BGR_LEFT, 2, 3, true)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_BGR_RIGHT, YUYV_TO_BGR_RIGHT, 2, 3,
+    true)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_GRAY, YUYV_TO_GRAY, 2, 1, false)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_GRAY_LEFT, YUYV_TO_GRAY_LEFT, 2, 1,
+    true)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_GRAY_RIGHT, YUYV_TO_GRAY_RIGHT, 2, 1,
+    true)->Apply(StreamSizes);
+
+// YUYV, aligned rows
+
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_RGB_ALIGNED, YUYV_TO_RGB, 2, 3, false,
+    true)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_Convert, YUYV_TO_RGB_LEFT_ALIGNED, YUYV_TO_RGB_LEFT, 2, 3,
+    true, true)->Apply(StreamSizes);
+
+// Depth
+
+BENCHMARK_CAPTURE(BM_DepthToGray, DEPTH_TO_GRAY, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_DepthToGray, DEPTH_TO_GRAY_RANGE, true)
+    ->Apply(StreamSizes);
+
+// In place
+
+BENCHMARK_CAPTURE(BM_ConvertInplace, RGB_TO_BGR, RGB_TO_BGR)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ConvertInplace, BGR_TO_RGB, BGR_TO_RGB)
+    ->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ConvertInplace, FLIP_UP_DOWN_C3, FLIP_UP_DOWN_C3)
+    ->Apply(StreamSizes);
@@ -0,0 +1,265 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "mynteyed/device/convertor.h"
+
+MYNTEYE_USE_NAMESPACE
+
+// Checks the YUYV and depth kernels of each instruction set bit-exact with
+// the scalar references, on random rows of odd sizes and steps. Returns 0 if
+// all passed.
+
+namespace {
+
+using bytes_t = std::vector<std::uint8_t>;
+using convert_t = int (*)(unsigned char*, unsigned char*,
+    unsigned int, unsigned int, unsigned int, unsigned int);
+
+// padding after each row, to check the steps and nothing written over
+const unsigned int kPadding = 7;
+const std::uint8_t kSentinel = 0xA5;
+
+// yuv_to_rgb_pixel() of the scalar path, as it was
+void reference_pixel(int y, int u, int v, std::uint8_t* rgb) {
+  int r = y + (1.370705 * (v-128));
+  int g = y - (0.698001 * (v-128)) - (0.337633 * (u-128));
+  int b = y + (1.732446 * (u-128));
+  int c[3] = {r, g, b};
+  for (int i = 0; i < 3; i++) {
+    if (c[i] > 255) c[i] = 255;
+    if (c[i] < 0) c[i] = 0;
+    rgb[i] = c[i] * 220 / 256;
+  }
+}
+
+struct Case {
+  const char* name;
+  convert_t convert;
+  // 3 if rgb or bgr, 1 if gray
+  int bpp;
+  bool bgr;
+  // 0 full, 1 left half, 2 right half
+  int half;
+};
+
+bool check(const Case& c, unsigned int width, unsigned int height,
+    std::mt19937* rng) {
+  unsigned int yuv_step = width * 2 + kPadding;
+  unsigned int out_width = c.half ? width / 2 : width;
+  unsigned int out_step = out_width * c.bpp + kPadding;
+
+  bytes_t yuv(yuv_step * height);
+  for (auto&& b : yuv) b = (*rng)() & 0xFF;
+  bytes_t out(out_step * height, kSentinel);
+  c.convert(yuv.data(), out.data(), width, height, out_step, yuv_step);
+
+  unsigned int x0 = c.half == 2 ? width / 2 : 0;
+  for (unsigned int r = 0; r < height; r++) {
+    const std::uint8_t* src = yuv.data() + r * yuv_step;
+    const std::uint8_t* dst = out.data() + r * out_step;
+    for (unsigned int x = 0; x < out_width; x++) {
+      unsigned int i = (x0 + x) * 2;
+      int y = src[i];
+      int u = src[(i & ~3u) + 1];
+      int v = src[(i & ~3u) + 3];
+      std::uint8_t expect[3];
+      if (c.bpp == 1) {
+        expect[0] = y;
+      } else {
+        std::uint8_t rgb[3];
+        reference_pixel(y, u, v, rgb);
+        expect[0] = c.bgr ? rgb[2] : rgb[0];
+        expect[1] = rgb[1];
+        expect[2] = c.bgr ? rgb[0] : rgb[2];
+      }
+      for (int k = 0; k < c.bpp; k++) {
+        if (dst[x * c.bpp + k] != expect[k]) {
+          std::printf("  %s %ux%u: row %u, pixel %u, channel %d: %d != %d\n",
+              c.name, width, height, r, x, k, dst[x * c.bpp + k], expect[k]);
+          return false;
+        }
+      }
+    }
+    for (unsigned int k = out_width * c.bpp; k < out_step; k++) {
+      if (dst[k] != kSentinel) {
+        std::printf("  %s %ux%u: row %u, written over the row\n",
+            c.name, width, height, r);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// 255 * (d - min) / (max - min) of the depth to gray as it was, d clamped
+// to [min, max]; 0 if flat, not divided by zero
+std::uint8_t reference_gray(std::uint16_t d, std::uint16_t min,
+    std::uint16_t max) {
+  if (max <= min) return 0;
+  if (d < min) d = min;
+  if (d > max) d = max;
+  return 255 * (d - min) / (max - min);
+}
+
+struct DepthCase {
+  const char* name;
+  // depth values drawn from [lo, hi]
+  std::uint16_t lo, hi;
+  // range of DEPTH_TO_GRAY_RANGE, or of the frame if near == far == 0
+  std::uint16_t near, far;
+};
+
+bool check_depth(const DepthCase& c, unsigned int width, unsigned int height,
+    std::mt19937* rng) {
+  // even, each row of 16-bit
+  unsigned int depth_step = width * 2 + kPadding * 2;
+  unsigned int gray_step = width + kPadding;
+
+  std::vector<std::uint16_t> depth(depth_step / 2 * height);
+  std::uniform_int_distribution<int> value(c.lo, c.hi);
+  for (auto&& d : depth) d = value(*rng);
+  bytes_t gray(gray_step * height, kSentinel);
+  auto data = reinterpret_cast<unsigned char*>(depth.data());
+
+  bool range = c.near != 0 || c.far != 0;
+  std::uint16_t min = c.near, max = c.far;
+  if (range) {
+    DEPTH_TO_GRAY_RANGE(data, gray.data(), width, height, c.near, c.far,
+        depth_step, gray_step);
+  } else {
+    DEPTH_TO_GRAY(data, gray.data(), width, height, depth_step, gray_step);
+    min = max = depth[0];
+    for (unsigned int r = 0; r < height; r++) {
+      for (unsigned int x = 0; x < width; x++) {
+        auto d = depth[r * depth_step / 2 + x];
+        if (d < min) min = d;
+        if (d > max) max = d;
+      }
+    }
+  }
+
+  for (unsigned int r = 0; r < height; r++) {
+    const std::uint16_t* src = depth.data() + r * depth_step / 2;
+    const std::uint8_t* dst = gray.data() + r * gray_step;
+    for (unsigned int x = 0; x < width; x++) {
+      auto expect = reference_gray(src[x], min, max);
+      if (dst[x] != expect) {
+        std::printf("  %s %ux%u: row %u, pixel %u, depth %d: %d != %d\n",
+            c.name, width, height, r, x, src[x], dst[x], expect);
+        return false;
+      }
+    }
+    for (unsigned int k = width; k < gray_step; k++) {
+      if (dst[k] != kSentinel) {
+        std::printf("  %s %ux%u: row %u, written over the row\n",
+            c.name, width, height, r);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  const Case cases[] = {
+    {"YUYV_TO_RGB", YUYV_TO_RGB, 3, false, 0},
+    {"YUYV_TO_RGB_LEFT", YUYV_TO_RGB_LEFT, 3, false, 1},
+    {"YUYV_TO_RGB_RIGHT", YUYV_TO_RGB_RIGHT, 3, false, 2},
+    {"YUYV_TO_BGR", YUYV_TO_BGR, 3, true, 0},
+    {"YUYV_TO_BGR_LEFT", YUYV_TO_BGR_LEFT, 3, true, 1},
+    {"YUYV_TO_BGR_RIGHT", YUYV_TO_BGR_RIGHT, 3, true, 2},
+    {"YUYV_TO_GRAY", YUYV_TO_GRAY, 1, false, 0},
+    {"YUYV_TO_GRAY_LEFT", YUYV_TO_GRAY_LEFT, 1, false, 1},
+    {"YUYV_TO_GRAY_RIGHT", YUYV_TO_GRAY_RIGHT, 1, false, 2},
+  };
+  // widths of 4n, so halves of whole macro pixels: tails of every size of
+  // the 8 or 16 pixels of sse2, 16 or 32 of avx2, and the stream modes
+  std::vector<unsigned int> widths;
+  for (unsigned int w = 4; w <= 132; w += 4) widths.push_back(w);
+  for (unsigned int w : {640u, 1280u, 2560u, 2564u, 2572u}) {
+    widths.push_back(w);
+  }
+  const struct {
+    const char* name;
+    YuyvKernels kernels;
+  } kernels[] = {
+    {"c", YuyvKernels::C},
+    {"sse2", YuyvKernels::SSE2},
+    {"avx2", YuyvKernels::AVX2},
+  };
+
+  int failed = 0;
+  for (auto&& k : kernels) {
+    if (!SET_YUYV_KERNELS(k.kernels)) {
+      std::printf("%s: not supported, skipped\n", k.name);
+      continue;
+    }
+    std::mt19937 rng(1);
+    int passed = 0, total = 0;
+    for (auto&& c : cases) {
+      for (auto&& w : widths) {
+        ++total;
+        if (check(c, w, 3, &rng)) ++passed;
+      }
+    }
+    std::printf("%s: %d/%d passed\n", k.name, passed, total);
+    failed += total - passed;
+  }
+
+  const DepthCase depth_cases[] = {
+    {"DEPTH_TO_GRAY", 0, 0xFFFF, 0, 0},
+    {"DEPTH_TO_GRAY_NARROW", 300, 4000, 0, 0},
+    {"DEPTH_TO_GRAY_FLAT", 1234, 1234, 0, 0},
+    {"DEPTH_TO_GRAY_RANGE", 0, 0xFFFF, 0, 0xFFFF},
+    {"DEPTH_TO_GRAY_RANGE_CLAMPED", 0, 6000, 500, 3000},
+    {"DEPTH_TO_GRAY_RANGE_ONE", 0, 6000, 2000, 2001},
+    {"DEPTH_TO_GRAY_RANGE_EMPTY", 0, 6000, 3000, 3000},
+    {"DEPTH_TO_GRAY_RANGE_INVERTED", 0, 6000, 3000, 500},
+  };
+  // odd widths: tails of every size of the 16 pixels of avx2
+  std::vector<unsigned int> depth_widths;
+  for (unsigned int w = 1; w <= 67; w += 2) depth_widths.push_back(w);
+  for (unsigned int w : {639u, 1279u, 1280u}) depth_widths.push_back(w);
+  const struct {
+    const char* name;
+    DepthKernels kernels;
+  } depth_kernels[] = {
+    {"depth c", DepthKernels::C},
+    {"depth avx2", DepthKernels::AVX2},
+  };
+
+  for (auto&& k : depth_kernels) {
+    if (!SET_DEPTH_KERNELS(k.kernels)) {
+      std::printf("%s: not supported, skipped\n", k.name);
+      continue;
+    }
+    std::mt19937 rng(1);
+    int passed = 0, total = 0;
+    for (auto&& c : depth_cases) {
+      for (auto&& w : depth_widths) {
+        ++total;
+        if (check_depth(c, w, 3, &rng)) ++passed;
+      }
+    }
+    std::printf("%s: %d/%d passed\n", k.name, passed, total);
+    failed += total - passed;
+  }
+  return failed == 0 ? 0 : 1;
+}
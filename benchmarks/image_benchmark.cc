@@ -0,0 +1,213 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <set>
+
+#include "mynteyed/device/data_caches.h"
+#include "mynteyed/device/image.h"
+
+#include "benchmark_utils.h"
+
+MYNTEYE_USE_NAMESPACE
+
+using namespace benchmarks;  // NOLINT
+
+namespace {
+
+int get_bpp(const ImageFormat& format) {
+  switch (format) {
+    case ImageFormat::IMAGE_GRAY_8: return 1;
+    case ImageFormat::IMAGE_GRAY_16: return 2;
+    case ImageFormat::IMAGE_YUYV: return 2;
+    default: return 3;
+  }
+}
+
+// A color frame of format with synthetic data, nullptr if not available
+Image::pointer create_color(const ImageFormat& format, int width,
+    int height) {
+  auto image = Image::Create(ImageType::IMAGE_LEFT_COLOR, format, width,
+      height, false);
+  if (format == ImageFormat::COLOR_MJPG) {
+    auto jpg = SyntheticJpeg(width, height);
+    if (jpg.empty()) return nullptr;
+    image->set_valid_size(jpg.size());
+    std::copy(jpg.begin(), jpg.end(), image->data());
+  } else {
+    auto bytes = RandomBytes(image->valid_size());
+    std::copy(bytes.begin(), bytes.end(), image->data());
+  }
+  return image;
+}
+
+// dual: convert the left half of a side-by-side frame
+void BM_ImageColorTo(benchmark::State& state, ImageFormat src,
+    ImageFormat dst, bool dual) {
+  int width = state.range(0), height = state.range(1);
+  auto image = create_color(src, width, height);
+  if (!image) {
+    state.SkipWithError("libjpeg not found");
+    return;
+  }
+  image->set_is_dual(dual);
+  std::size_t pixels = (dual ? width / 2 : width) * height;
+  for (auto _ : state) {
+    // A new frame, as To() caches the result on the frame
+    state.PauseTiming();
+    auto frame = image->Clone();
+    if (dual) frame = frame->Shadow(ImageType::IMAGE_LEFT_COLOR);
+    state.ResumeTiming();
+    auto result = frame->To(dst);
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, pixels, pixels * get_bpp(dst));
+}
+
+void BM_ImageDepthTo(benchmark::State& state) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t pixels = width * height;
+  auto image = Image::Create(ImageType::IMAGE_DEPTH, ImageFormat::DEPTH_RAW,
+      width, height, false);
+  auto depths = RandomDepths(pixels, 300, 10000);
+  std::copy(depths.begin(), depths.end(),
+      reinterpret_cast<std::uint16_t*>(image->data()));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto frame = image->Clone();
+    state.ResumeTiming();
+    auto result = frame->To(ImageFormat::DEPTH_GRAY);
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, pixels, pixels);
+}
+
+void BM_ImageClone(benchmark::State& state) {
+  int width = state.range(0), height = state.range(1);
+  auto image = create_color(ImageFormat::COLOR_YUYV, width, height);
+  for (auto _ : state) {
+    auto result = image->Clone();
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, width * height, image->valid_size());
+}
+
+void BM_ImageShadow(benchmark::State& state) {
+  int width = state.range(0), height = state.range(1);
+  auto image = create_color(ImageFormat::COLOR_YUYV, width, height);
+  image->set_is_dual(true);
+  for (auto _ : state) {
+    auto result = image->Shadow(ImageType::IMAGE_RIGHT_COLOR);
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, width * height, 0);
+}
+
+void BM_ImageView(benchmark::State& state) {
+  int width = state.range(0), height = state.range(1);
+  auto image = create_color(ImageFormat::COLOR_YUYV, width, height);
+  image->set_is_dual(true);
+  auto right = image->Shadow(ImageType::IMAGE_RIGHT_COLOR);
+  for (auto _ : state) {
+    auto result = right->View();
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, width / 2 * height, 0);
+}
+
+// To() again on the same frame, returns the cached
+void BM_ImageToCached(benchmark::State& state) {
+  int width = state.range(0), height = state.range(1);
+  auto image = create_color(ImageFormat::COLOR_YUYV, width, height);
+  image->To(ImageFormat::COLOR_BGR);
+  for (auto _ : state) {
+    auto result = image->To(ImageFormat::COLOR_BGR);
+    benchmark::DoNotOptimize(result->data());
+  }
+  SetPixelCounters(state, width * height, 0);
+}
+
+// proper: ask a size between the proper sizes
+void BM_DataCaches(benchmark::State& state, bool proper) {
+  int width = state.range(0), height = state.range(1);
+  std::size_t size = width * height * 2;
+
+  DataCaches caches;
+  std::set<std::size_t> sizes;
+  for (auto&& bpp : {1, 2, 3}) {
+    for (auto&& pixels : {640*480, 1280*480, 1280*720, 2560*720}) {
+      sizes.insert(pixels * bpp);
+    }
+  }
+  caches.SetProperSizes(sizes);
+
+  for (auto _ : state) {
+    auto data = proper ? caches.GetProper(size - 1) : caches.GetFixed(size);
+    benchmark::DoNotOptimize(data->data());
+  }
+  SetPixelCounters(state, width * height, 0);
+}
+
+// Gets from several threads at once, each holds a few buffers like consumers
+void BM_DataCachesThreads(benchmark::State& state) {
+  static DataCaches caches;
+  std::size_t size = 1280 * 720 * 2;
+
+  for (auto _ : state) {
+    auto a = caches.GetFixed(size);
+    auto b = caches.GetFixed(size);
+    benchmark::DoNotOptimize(a->data());
+    benchmark::DoNotOptimize(b->data());
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+}  // namespace
+
+// ImageColor::To
+
+BENCHMARK_CAPTURE(BM_ImageColorTo, YUYV_TO_RGB, ImageFormat::COLOR_YUYV,
+    ImageFormat::COLOR_RGB, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, YUYV_TO_BGR, ImageFormat::COLOR_YUYV,
+    ImageFormat::COLOR_BGR, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, YUYV_TO_GRAY, ImageFormat::COLOR_YUYV,
+    ImageFormat::COLOR_GRAY, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, YUYV_TO_BGR_LEFT, ImageFormat::COLOR_YUYV,
+    ImageFormat::COLOR_BGR, true)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, MJPG_TO_RGB, ImageFormat::COLOR_MJPG,
+    ImageFormat::COLOR_RGB, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, MJPG_TO_BGR, ImageFormat::COLOR_MJPG,
+    ImageFormat::COLOR_BGR, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, MJPG_TO_GRAY, ImageFormat::COLOR_MJPG,
+    ImageFormat::COLOR_GRAY, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_ImageColorTo, MJPG_TO_BGR_LEFT, ImageFormat::COLOR_MJPG,
+    ImageFormat::COLOR_BGR, true)->Apply(StreamSizes);
+
+// ImageDepth::To
+
+BENCHMARK(BM_ImageDepthTo)->Apply(StreamSizes);
+
+// Image
+
+BENCHMARK(BM_ImageClone)->Apply(StreamSizes);
+BENCHMARK(BM_ImageShadow)->Apply(StreamSizes);
+BENCHMARK(BM_ImageView)->Apply(StreamSizes);
+BENCHMARK(BM_ImageToCached)->Apply(StreamSizes);
+
+// DataCaches
+
+BENCHMARK_CAPTURE(BM_DataCaches, GetFixed, false)->Apply(StreamSizes);
+BENCHMARK_CAPTURE(BM_DataCaches, GetProper, true)->Apply(StreamSizes);
+BENCHMARK(BM_DataCachesThreads)->ThreadRange(1, 4)->UseRealTime();
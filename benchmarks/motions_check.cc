@@ -0,0 +1,164 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "mynteyed/internal/motions.h"
+
+MYNTEYE_USE_NAMESPACE
+
+// Checks the imu calibration of each process mode bit-exact with the
+// temperature drift and assembly applied apart as they were, on random
+// packets and intrinsics. Returns 0 if all passed.
+
+namespace {
+
+// Count of the random packets, accel and gyro in turn
+const int kPackets = 20000;
+// The first packets dropped by motions
+const int kSkipped = 20;
+
+// ProcImuTempDrift() as it was
+void reference_temp_drift(const ImuIntrinsics& in, double temp, double* v) {
+  v[0] -= in.x[1] * temp + in.x[0];
+  v[1] -= in.y[1] * temp + in.y[0];
+  v[2] -= in.z[1] * temp + in.z[0];
+}
+
+// ProcImuAssembly() as it was: scale * assembly, then times the vector
+void reference_assembly(const ImuIntrinsics& in, double* v) {
+  double dst[3][3] = {{0}};
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 3; k++) {
+        dst[i][j] += in.scale[i][k] * in.assembly[k][j];
+      }
+    }
+  }
+  double d[3] = {0};
+  for (int i = 0; i < 3; i++) {
+    for (int k = 0; k < 3; k++) {
+      d[i] += dst[i][k] * v[k];
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    v[i] = d[i];
+  }
+}
+
+// ProcImuData() as it was
+ImuData reference_imu(const MotionIntrinsics& in, std::int32_t mode,
+    const ImuDataPacket& packet) {
+  ImuData imu;
+  imu.Reset();
+  imu.flag = packet.flag;
+  imu.temperature = static_cast<double>(packet.temperature * 0.125 + 23);
+  bool is_accel = imu.flag == MYNTEYE_IMU_ACCEL;
+  double* v = is_accel ? imu.accel : imu.gyro;
+  float range = is_accel ? 12.f : 2000.f;
+  for (int i = 0; i < 3; i++) {
+    v[i] = packet.accel_or_gyro[i] * range / 0x10000;
+  }
+
+  auto&& intrinsics = is_accel ? in.accel : in.gyro;
+  bool proc_assembly = (mode & ProcessMode::PROC_IMU_ASSEMBLY) > 0;
+  bool proc_temp_drift = (mode & ProcessMode::PROC_IMU_TEMP_DRIFT) > 0;
+  if (proc_temp_drift) reference_temp_drift(intrinsics, imu.temperature, v);
+  if (proc_assembly) reference_assembly(intrinsics, v);
+  return imu;
+}
+
+bool check(const MotionIntrinsics& in, std::int32_t mode, std::mt19937* rng) {
+  std::vector<ImuDataPacket> packets(kPackets);
+  for (int n = 0; n < kPackets; n++) {
+    auto&& packet = packets[n];
+    packet.flag = (n % 2 == 0) ? MYNTEYE_IMU_ACCEL : MYNTEYE_IMU_GYRO;
+    packet.timestamp = n + 1;
+    packet.device_timestamp = n + 1;
+    packet.host_timestamp = 0;
+    packet.temperature = static_cast<std::int16_t>((*rng)() % 400) - 200;
+    for (int i = 0; i < 3; i++) {
+      packet.accel_or_gyro[i] =
+          static_cast<std::int16_t>((*rng)() % 0x10000 - 0x8000);
+    }
+  }
+
+  Motions motions;
+  motions.SetMotionIntrinsics(std::make_shared<MotionIntrinsics>(in));
+  motions.EnableProcessMode(mode);
+  motions.EnableMotionDatas(kPackets);
+  motions.OnImuDatasCallback(packets);
+  auto&& datas = motions.GetMotionDatas();
+  if (datas.size() != packets.size() - kSkipped) {
+    std::printf("  mode %d: %zu datas of %zu packets\n", mode, datas.size(),
+        packets.size());
+    return false;
+  }
+
+  for (std::size_t n = 0; n < datas.size(); n++) {
+    auto&& imu = *datas[n].imu;
+    auto&& expect = reference_imu(in, mode, packets[n + kSkipped]);
+    for (int i = 0; i < 3; i++) {
+      if (imu.accel[i] != expect.accel[i] || imu.gyro[i] != expect.gyro[i]) {
+        std::printf("  mode %d: packet %zu, axis %d: accel %.17g != %.17g, "
+            "gyro %.17g != %.17g\n", mode, n + kSkipped, i, imu.accel[i],
+            expect.accel[i], imu.gyro[i], expect.gyro[i]);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> uniform(-1.5, 1.5);
+  MotionIntrinsics in;
+  for (auto&& intrinsics : {&in.accel, &in.gyro}) {
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        intrinsics->scale[i][j] = uniform(rng);
+        intrinsics->assembly[i][j] = uniform(rng);
+      }
+    }
+    for (int i = 0; i < 2; i++) {
+      intrinsics->x[i] = uniform(rng);
+      intrinsics->y[i] = uniform(rng);
+      intrinsics->z[i] = uniform(rng);
+    }
+  }
+
+  const struct {
+    const char* name;
+    ProcessMode mode;
+  } modes[] = {
+    {"PROC_NONE", ProcessMode::PROC_NONE},
+    {"PROC_IMU_ASSEMBLY", ProcessMode::PROC_IMU_ASSEMBLY},
+    {"PROC_IMU_TEMP_DRIFT", ProcessMode::PROC_IMU_TEMP_DRIFT},
+    {"PROC_IMU_ALL", ProcessMode::PROC_IMU_ALL},
+  };
+
+  int failed = 0;
+  for (auto&& m : modes) {
+    bool passed = check(in, static_cast<std::int32_t>(m.mode), &rng);
+    std::printf("%s: %s\n", m.name, passed ? "passed" : "failed");
+    if (!passed) ++failed;
+  }
+  return failed == 0 ? 0 : 1;
+}
@@ -29,6 +29,17 @@ if(JPEG_FOUND)
 set(WITH_JPEG TRUE)
 add_definitions(-DWITH_JPEG)
 
+# jpeg_crop_scanline() of libjpeg-turbo >= 1.5, decodes part columns only
+include(CheckSymbolExists)
+set(CMAKE_REQUIRED_INCLUDES ${JPEG_INCLUDE_DIR})
+set(CMAKE_REQUIRED_LIBRARIES ${JPEG_LIBRARIES})
+check_symbol_exists(jpeg_crop_scanline "stdio.h;jpeglib.h" WITH_JPEG_CROP)
+unset(CMAKE_REQUIRED_INCLUDES)
+unset(CMAKE_REQUIRED_LIBRARIES)
+if(WITH_JPEG_CROP)
+  add_definitions(-DWITH_JPEG_CROP)
+endif()
+
 else()
 
 set(WITH_JPEG FALSE)
@@ -0,0 +1,41 @@
+# Copyright 2018 Slightech Co., Ltd. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+include(${CMAKE_CURRENT_LIST_DIR}/IncludeGuard.cmake)
+cmake_include_guard()
+
+# libusb-1.0, reads the hid asynchronously with transfers in flight
+
+find_path(LibUSB1_INCLUDE_DIR libusb.h PATH_SUFFIXES libusb-1.0)
+find_library(LibUSB1_LIBRARY NAMES usb-1.0 libusb-1.0)
+
+if(LibUSB1_INCLUDE_DIR AND LibUSB1_LIBRARY)
+
+if(NOT LibUSB1_FIND_QUIET)
+  message(STATUS "Found LibUSB1: ${LibUSB1_LIBRARY}")
+endif()
+
+set(LibUSB1_FOUND TRUE)
+set(LibUSB1_INCLUDE_DIRS ${LibUSB1_INCLUDE_DIR})
+set(LibUSB1_LIBRARIES ${LibUSB1_LIBRARY})
+
+set(WITH_LIBUSB1 TRUE)
+add_definitions(-DWITH_LIBUSB1)
+
+else()
+
+set(LibUSB1_FOUND FALSE)
+set(WITH_LIBUSB1 FALSE)
+
+endif()
@@ -0,0 +1,41 @@
+# Copyright 2018 Slightech Co., Ltd. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+include(${CMAKE_CURRENT_LIST_DIR}/IncludeGuard.cmake)
+cmake_include_guard()
+
+# TurboJPEG API of libjpeg-turbo, decodes MJPG faster than libjpeg
+
+find_path(TurboJPEG_INCLUDE_DIR turbojpeg.h)
+find_library(TurboJPEG_LIBRARY NAMES turbojpeg libturbojpeg)
+
+if(TurboJPEG_INCLUDE_DIR AND TurboJPEG_LIBRARY)
+
+if(NOT TurboJPEG_FIND_QUIET)
+  message(STATUS "Found TurboJPEG: ${TurboJPEG_LIBRARY}")
+endif()
+
+set(TurboJPEG_FOUND TRUE)
+set(TurboJPEG_INCLUDE_DIRS ${TurboJPEG_INCLUDE_DIR})
+set(TurboJPEG_LIBRARIES ${TurboJPEG_LIBRARY})
+
+set(WITH_TURBOJPEG TRUE)
+add_definitions(-DWITH_TURBOJPEG)
+
+else()
+
+set(TurboJPEG_FOUND FALSE)
+set(WITH_TURBOJPEG FALSE)
+
+endif()
@@ -97,5 +97,12 @@ status("JPEG: " IF WITH_JPEG "YES" ELSE "NO")
 if(WITH_JPEG AND JPEG_VERSION)
   status("  JPEG_VERSION: ${JPEG_VERSION}")
 endif()
+if(WITH_JPEG)
+  status("  JPEG_CROP: " IF WITH_JPEG_CROP "YES" ELSE "NO")
+endif()
+status("TurboJPEG: " IF WITH_TURBOJPEG "YES" ELSE "NO")
+
+status("")
+status("LibUSB1: " IF WITH_LIBUSB1 "YES" ELSE "NO")
 
 status("")
@@ -38,6 +38,9 @@ class MYNTEYE_API Camera {
         std::function<void(const std::shared_ptr<ImgInfo>& info)>;
   using stream_callback_t = std::function<void(const StreamData& data)>;
   using motion_callback_t = std::function<void(const MotionData& data)>;
+  using motion_batch_callback_t =
+      std::function<void(const ImuData* datas, std::size_t count)>;
+  using frameset_callback_t = std::function<void(const FrameSet& frameset)>;
 
   Camera();
   ~Camera();
@@ -138,6 +141,23 @@ class MYNTEYE_API Camera {
   StreamData GetStreamData(const ImageType& type);
   /** Get cached stream datas */
   std::vector<StreamData> GetStreamDatas(const ImageType& type);
+  /** Set the options to assemble frame sets */
+  void SetFrameSetOptions(const FrameSetOptions& options);
+  /**
+   * Get latest frame set, of all the stream datas enabled of one capture
+   * instant. Blocks until one if none.
+   */
+  FrameSet GetFrameSet();
+  /** Get the latency of stream data of certain image type */
+  StreamLatency GetStreamLatency(const ImageType& type) const;
+  /** Get the stats of syncing stream data of certain image type with infos */
+  StreamSyncStats GetStreamSyncStats(const ImageType& type) const;
+
+  /**
+   * Get the stats of the motion channel: reads, and the ones dropped if
+   * the processing of motion datas and image infos fell behind
+   */
+  MotionChannelStats GetMotionChannelStats() const;
 
   /** Whethor motion datas supported or not */
   bool IsMotionDatasSupported() const;
@@ -156,8 +176,68 @@ class MYNTEYE_API Camera {
   /** Whethor motion datas enabled or not */
   bool IsMotionDatasEnabled() const;
 
+  /**
+   * Enable motion pairing, then each motion data is 6-DoF, flag
+   * MYNTEYE_IMU_ACCEL_GYRO, accel and gyro linearly interpolated at its
+   * timestamp. The timestamps are of the rate in hz, or of the gyro if rate
+   * is 0.
+   */
+  void EnableMotionPairing(std::uint32_t rate = 0);
+  /** Disable motion pairing. */
+  void DisableMotionPairing();
+
   /** Get cached motion datas. Besides, you can also get them from callback */
   std::vector<MotionData> GetMotionDatas();
+  /**
+   * Get the recent motion datas after from till to, by the timestamps of the
+   * device, same as of the image infos. Not drained as GetMotionDatas().
+   */
+  std::vector<MotionData> GetMotionDatas(std::uint64_t from, std::uint64_t to);
+  /**
+   * Same as above, but appends the values to datas, returns how many. Reuse
+   * datas to get without allocation.
+   */
+  std::size_t GetMotionDatas(std::uint64_t from, std::uint64_t to,
+      std::vector<ImuData>* datas);
+
+  /**
+   * Enable stream motion datas, then each StreamData has the motion datas
+   * after its previous frame till it, by the timestamps of the image infos.
+   *
+   * Note: must enable motion datas and sync image infos also. The motion
+   * datas come after a frame delivered are not of it.
+   */
+  void EnableStreamMotionDatas();
+  /** Disable stream motion datas. */
+  void DisableStreamMotionDatas();
+
+  /**
+   * Enable preintegration, then each StreamData has the imu preintegration
+   * after its previous frame till it, by the timestamps of the image infos.
+   * It's integrated as the motion datas come, with the noise densities and
+   * random walks of the motion intrinsics.
+   *
+   * Note: must enable motion datas and sync image infos also.
+   */
+  void EnablePreintegration();
+  /** Disable preintegration. */
+  void DisablePreintegration();
+  /** Set the biases subtracted since the next frame, in m/s^2 and rad/s */
+  void SetPreintegrationBias(const double (&accel)[3],
+      const double (&gyro)[3]);
+  /**
+   * Preintegrate the recent motion datas from till to, by the timestamps of
+   * the device. Return false if not covered by them.
+   */
+  bool GetPreintegration(std::uint64_t from, std::uint64_t to,
+      ImuPreintegration* result);
+
+  /**
+   * Get the host time, in ns of std::chrono::steady_clock, of the unwrapped
+   * timestamp of the device. The clocks are synced as the motion datas or
+   * image infos come, 0 if none came yet.
+   */
+  std::int64_t GetHostTimestamp(std::uint64_t device_timestamp) const;
 
   /** Set image info callback. */
   void SetImgInfoCallback(img_info_callback_t callback, bool async = true);
@@ -168,6 +248,16 @@ class MYNTEYE_API Camera {
 
   /** Set motion data callback. */
   void SetMotionCallback(motion_callback_t callback, bool async = true);
+  /**
+   * Set motion batch callback, once the datas of each read of the device.
+   *
+   * Note: it's called on the thread reading the device, should return soon.
+   * The datas are valid only during the call.
+   */
+  void SetMotionBatchCallback(motion_batch_callback_t callback);
+
+  /** Set frame set callback, see GetFrameSet(). */
+  void SetFrameSetCallback(frameset_callback_t callback, bool async = true);
 
   /** Close the camera */
   void Close();
@@ -16,8 +16,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <iostream>
 
@@ -25,6 +27,7 @@
 #include <opencv2/core/core.hpp>
 #endif
 
+#include "mynteyed/device/image_storage.h"
 #include "mynteyed/device/types.h"
 #include "mynteyed/stubs/global.h"
 
@@ -34,18 +37,47 @@ class MYNTEYE_API Image {
  public:
   using pointer = std::shared_ptr<Image>;
 
-  using data_t = std::vector<std::uint8_t>;
+  using data_t = ImageStorage;
   using data_ptr_t = std::shared_ptr<data_t>;
 
+  /** A rectangle of an image, in pixels. */
+  struct Roi {
+    int x;
+    int y;
+    int width;
+    int height;
+  };
+
  protected:
+  /**
+   * Views data from offset if given, otherwise allocates.
+   */
   Image(const ImageType& type, const ImageFormat& format,
-      int width, int height, bool is_buffer);
+      int width, int height, bool is_buffer, std::size_t step,
+      const data_ptr_t& data = nullptr, std::size_t offset = 0);
 
  public:
   virtual ~Image();
 
+  /**
+   * Creates an image, step is the bytes of a row, 0 means packed.
+   */
+  static pointer Create(const ImageType& type, const ImageFormat& format,
+      int width, int height, bool is_buffer, std::size_t step = 0);
+
+ protected:
   static pointer Create(const ImageType& type, const ImageFormat& format,
-      int width, int height, bool is_buffer);
+      int width, int height, std::size_t step, const data_ptr_t& data,
+      std::size_t offset);
+
+ public:
+  /**
+   * Rows of the converted images are aligned to it, padded at the end.
+   * Default 1, packed. ImageStorage::ALIGNMENT makes each row start at a
+   * cache line, then could load with aligned SIMD.
+   */
+  static void SetRowAlignment(std::size_t alignment);
+  static std::size_t GetRowAlignment();
 
   ImageType type() const {
     return type_;
@@ -67,10 +99,20 @@ class MYNTEYE_API Image {
     return width_ * height_;
   }
 
+  // Bytes of a row, including the padding if any
+  std::size_t step() const {
+    return step_;
+  }
+
   bool is_buffer() const {
     return is_buffer_;
   }
 
+  // Whether shares the rows of another image, see View()
+  bool is_view() const {
+    return is_view_;
+  }
+
   int frame_id() const {
     return frame_id_;
   }
@@ -79,6 +121,15 @@ class MYNTEYE_API Image {
     frame_id_ = frame_id;
   }
 
+  // Host time of the frame, in ns of std::chrono::steady_clock
+  std::int64_t host_timestamp() const {
+    return host_timestamp_;
+  }
+
+  void set_host_timestamp(std::int64_t host_timestamp) {
+    host_timestamp_ = host_timestamp;
+  }
+
   bool is_dual() const {
     return is_dual_;
   }
@@ -88,15 +139,16 @@ class MYNTEYE_API Image {
   }
 
   std::uint8_t* data() {
-    return data_->data();
+    return data_->data() + offset_;
   }
 
   const std::uint8_t* data() const {
-    return data_->data();
+    return data_->data() + offset_;
   }
 
+  // Bytes from data() to the end
   std::size_t data_size() const {
-    return data_->size();
+    return data_->size() - offset_;
   }
 
   std::size_t valid_size() const {
@@ -106,15 +158,38 @@ class MYNTEYE_API Image {
   // will resize data if larger then data size
   void set_valid_size(std::size_t valid_size);
 
+  /**
+   * Converts to the format, or returns this if already is.
+   *
+   * The result is computed once and cached on this frame, later calls from
+   * any thread return the same image. Images are not converted in place, so
+   * the result and this could be shared; take them as read only, Clone()
+   * before modifying.
+   */
   virtual pointer To(const ImageFormat& format) = 0;
 
 #ifdef WITH_OPENCV
   cv::Mat ToMat();
 #endif
 
+  /**
+   * Copies the data, the rows of a view are packed then.
+   */
   pointer Clone() const;
   pointer Shadow(const ImageType& type) const;
 
+  /**
+   * Views the roi of this image without copy, sharing the data and step.
+   * The view is not dual, and could not be of a MJPG image. The x and width
+   * must be even if YUYV.
+   */
+  pointer View(const Roi& roi) const;
+  pointer View(const Roi& roi, const ImageType& type) const;
+  /**
+   * Views the left or right half as the type if dual, otherwise the whole.
+   */
+  pointer View() const;
+
   bool ResetBuffer();
 
  protected:
@@ -123,11 +198,17 @@ class MYNTEYE_API Image {
   int width_;
   int height_;
   bool is_buffer_;
+  std::size_t step_;
+  // Offset of the first row in data
+  std::size_t offset_;
+  bool is_view_;
 
   ImageFormat raw_format_;
 
   // Frame id
   int frame_id_;
+  // Host timestamp
+  std::int64_t host_timestamp_;
   // Special state for dual data
   bool is_dual_;
 
@@ -135,6 +216,17 @@ class MYNTEYE_API Image {
   // The real valid size of some compress format or other cases.
   std::size_t valid_size_;
 
+  // Decoded images shared with shadows, so decode once for all of them
+  struct DecodeCache;
+  mutable std::shared_ptr<DecodeCache> decode_cache_;
+
+  // Returns the converted image cached, or converts and caches it
+  pointer Memoize(const ImageFormat& format, std::function<pointer()> convert);
+
+  // Converted images of this frame
+  std::map<ImageFormat, pointer> converted_;
+  std::mutex converted_mutex_;
+
   MYNTEYE_DISABLE_COPY(Image)
   MYNTEYE_DISABLE_MOVE(Image)
 };
@@ -146,23 +238,28 @@ class MYNTEYE_API ImageColor : public Image,
 
  protected:
   ImageColor(const ImageType& type, const ImageFormat& format,
-      int width, int height, bool is_buffer);
+      int width, int height, bool is_buffer, std::size_t step,
+      const data_ptr_t& data = nullptr, std::size_t offset = 0);
 
  public:
   virtual ~ImageColor();
 
   static pointer Create(const ImageFormat& format, int width, int height,
-      bool is_buffer) {
+      bool is_buffer, std::size_t step = 0) {
     return Create(ImageType::IMAGE_LEFT_COLOR, format, width, height,
-        is_buffer);
+        is_buffer, step);
   }
 
   static pointer Create(const ImageType& type, const ImageFormat& format,
-      int width, int height, bool is_buffer);
+      int width, int height, bool is_buffer, std::size_t step = 0);
 
   Image::pointer To(const ImageFormat& format) override;
 
  private:
+  friend class Image;
+
+  Image::pointer Convert(const ImageFormat& format);
+
   MYNTEYE_DISABLE_COPY(ImageColor)
   MYNTEYE_DISABLE_MOVE(ImageColor)
 };
@@ -173,19 +270,34 @@ class MYNTEYE_API ImageDepth : public Image,
   using pointer = std::shared_ptr<ImageDepth>;
 
  protected:
-  ImageDepth(const ImageFormat& format, int width, int height, bool is_buffer);
+  ImageDepth(const ImageFormat& format, int width, int height, bool is_buffer,
+      std::size_t step, const data_ptr_t& data = nullptr,
+      std::size_t offset = 0);
 
  public:
   virtual ~ImageDepth();
 
   static pointer Create(const ImageFormat& format, int width, int height,
-      bool is_buffer) {
-    return pointer(new ImageDepth(format, width, height, is_buffer));
+      bool is_buffer, std::size_t step = 0) {
+    return pointer(new ImageDepth(format, width, height, is_buffer, step));
   }
 
+  /**
+   * Range of DEPTH_RAW in mm normalized to DEPTH_GRAY, out of it clamped.
+   * Default 0, 0: of the min and max of each frame, which costs one more
+   * pass. near >= far resets to it.
+   */
+  static void SetGrayRange(std::uint16_t depth_near, std::uint16_t depth_far);
+  static void GetGrayRange(std::uint16_t* depth_near,
+      std::uint16_t* depth_far);
+
   Image::pointer To(const ImageFormat& format) override;
 
  private:
+  friend class Image;
+
+  Image::pointer Convert(const ImageFormat& format);
+
   MYNTEYE_DISABLE_COPY(ImageDepth)
   MYNTEYE_DISABLE_MOVE(ImageDepth)
 };
@@ -0,0 +1,96 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_DEVICE_IMAGE_STORAGE_H_
+#define MYNTEYE_DEVICE_IMAGE_STORAGE_H_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * The bytes of an image, not initialized and aligned to a cache line.
+ */
+class MYNTEYE_API ImageStorage {
+ public:
+  /** Alignment of the data, a cache line, fits any SIMD load. */
+  static const std::size_t ALIGNMENT = 64;
+
+  /**
+   * Allocates size bytes, not zero filled.
+   *
+   * If huge_pages and size is large, aligns to huge pages and advises the
+   * kernel to back it with them, where supported.
+   */
+  explicit ImageStorage(std::size_t size, bool huge_pages = false);
+  ~ImageStorage();
+
+  std::uint8_t* data() {
+    return data_;
+  }
+
+  const std::uint8_t* data() const {
+    return data_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  std::uint8_t& operator[](std::size_t i) {
+    return data_[i];
+  }
+
+  const std::uint8_t& operator[](std::size_t i) const {
+    return data_[i];
+  }
+
+  std::uint8_t* begin() {
+    return data_;
+  }
+
+  const std::uint8_t* begin() const {
+    return data_;
+  }
+
+  std::uint8_t* end() {
+    return data_ + size_;
+  }
+
+  const std::uint8_t* end() const {
+    return data_ + size_;
+  }
+
+  bool huge_pages() const {
+    return huge_pages_;
+  }
+
+  /** Writes every page, then accessing it will not page fault. */
+  void Prefault();
+
+ private:
+  std::uint8_t* data_;
+  std::size_t size_;
+  bool huge_pages_;
+
+  MYNTEYE_DISABLE_COPY(ImageStorage)
+  MYNTEYE_DISABLE_MOVE(ImageStorage)
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_DEVICE_IMAGE_STORAGE_H_
@@ -97,6 +97,95 @@ struct MYNTEYE_API OpenParams {
    */
   bool ir_depth_only;
 
+  /**
+   * Threads to convert images with, default 0.
+   * Note: 0 means hardware concurrency, 1 converts on the calling thread only.
+   */
+  std::int32_t convert_threads;
+
+  /**
+   * Least rows of a band when converting images in parallel, default 64.
+   */
+  std::int32_t convert_min_band_rows;
+
+  /**
+   * Image buffers to allocate ahead of each size the streams need, default 0.
+   * Note: they are allocated and page faulted on open, avoid the latency
+   * spikes of the first frames.
+   */
+  std::int32_t cache_prewarm_count;
+
+  /**
+   * Max bytes of the image buffers pooled, default 0 means no limit.
+   * Note: over it, #cache_policy applies, a frame allocated is freed once
+   * released, not pooled.
+   */
+  std::uint64_t cache_max_bytes;
+
+  /**
+   * Max image buffers pooled of each size, range [0,64], default 12.
+   */
+  std::int32_t cache_capacity;
+
+  /**
+   * Cache policy if all the image buffers of a size are in use at
+   * #cache_capacity or #cache_max_bytes, default CACHE_ALLOCATE.
+   * Note: the frames dropped are retried by the capture, not delivered.
+   */
+  CachePolicy cache_policy;
+
+  /**
+   * Wait a buffer released this long if CACHE_BLOCK, in milliseconds,
+   * default 1000.
+   */
+  std::int32_t cache_block_timeout_ms;
+
+  /**
+   * Free the image buffers unused for about this long, in milliseconds,
+   * default 0 means never. The prewarmed ones are kept.
+   */
+  std::int32_t cache_idle_timeout_ms;
+
+  /**
+   * Allocate the large image buffers on huge pages if could, default false.
+   * Note: fewer TLB misses when converting, Linux only, otherwise ignored.
+   */
+  bool cache_huge_pages;
+
+  /**
+   * Align each row of the converted images to 64 bytes, default false.
+   * Note: rows are padded then, use Image::step() or ToMat() rather than
+   * assume width * bytes per pixel.
+   */
+  bool align_image_rows;
+
+  /**
+   * Range of depth in mm normalized to DEPTH_GRAY, default 0, 0.
+   * Note: if near < far, depth out of it is clamped and gray of each frame
+   * is comparable; otherwise normalized of the min and max of each frame.
+   */
+  std::uint16_t depth_gray_near;
+  std::uint16_t depth_gray_far;
+
+  /**
+   * CPU to pin the color capture thread to, from 0, default -1 not pinned.
+   * Note: color and depth are captured on their own threads, each blocks
+   * reading the device and delivers a frame once it arrives.
+   */
+  std::int32_t capture_color_cpu;
+
+  /**
+   * CPU to pin the depth capture thread to, from 0, default -1 not pinned.
+   */
+  std::int32_t capture_depth_cpu;
+
+  /**
+   * Raise the priority of the capture threads, default false.
+   * Note: real-time scheduling on Linux, which needs the privilege;
+   * warned and ignored if failed.
+   */
+  bool capture_high_priority;
+
   /** Constructor. */
   OpenParams();
   explicit OpenParams(const std::int32_t& dev_index);
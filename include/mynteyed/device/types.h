@@ -115,8 +115,9 @@ enum class ImageFormat : std::int32_t {
   // color
   COLOR_BGR   = IMAGE_BGR_24,  // > COLOR_RGB
   COLOR_RGB   = IMAGE_RGB_24,  // > COLOR_BGR
-  COLOR_YUYV  = IMAGE_YUYV,    // > COLOR_BGR, COLOR_RGB
-  COLOR_MJPG  = IMAGE_MJPG,    // > COLOR_BGR, COLOR_RGB
+  COLOR_YUYV  = IMAGE_YUYV,    // > COLOR_BGR, COLOR_RGB, COLOR_GRAY
+  COLOR_MJPG  = IMAGE_MJPG,    // > COLOR_BGR, COLOR_RGB, COLOR_GRAY
+  COLOR_GRAY  = IMAGE_GRAY_8,  // luma only, < COLOR_YUYV, COLOR_MJPG
   // depth
   DEPTH_RAW     = IMAGE_GRAY_16,  // > DEPTH_GRAY
   DEPTH_GRAY    = IMAGE_GRAY_8,
@@ -127,6 +128,21 @@ enum class ImageFormat : std::int32_t {
   IMAGE_FORMAT_LAST
 };
 
+/**
+ * @ingroup enumerations
+ * @brief List cache policies, if all the image buffers of a size are in use.
+ */
+enum class CachePolicy : std::int32_t {
+  /** Allocate one more, freed rather than pooled once released */
+  CACHE_ALLOCATE = 0,
+  /** Wait a buffer released, drop the frame if timeout */
+  CACHE_BLOCK    = 1,
+  /** Drop the frame at once */
+  CACHE_FAIL     = 2,
+  /** Last guard. */
+  CACHE_POLICY_LAST
+};
+
 MYNTEYE_END_NAMESPACE
 
 #endif  // MYNTEYE_DEVICE_TYPES_H_
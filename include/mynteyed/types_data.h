@@ -41,10 +41,18 @@ struct MYNTEYE_API ImgInfo {
   /** Image exposure time */
   std::uint16_t exposure_time;
 
+  /** Image timestamp unwrapped, monotonic of the device, in 0.01ms */
+  std::uint64_t device_timestamp;
+
+  /** Image timestamp of the host, in ns of std::chrono::steady_clock */
+  std::int64_t host_timestamp;
+
   void Reset() {
     frame_id = 0;
     timestamp = 0;
     exposure_time = 0;
+    device_timestamp = 0;
+    host_timestamp = 0;
   }
 
   ImgInfo() {
@@ -54,17 +62,22 @@ struct MYNTEYE_API ImgInfo {
     frame_id = other.frame_id;
     timestamp = other.timestamp;
     exposure_time = other.exposure_time;
+    device_timestamp = other.device_timestamp;
+    host_timestamp = other.host_timestamp;
   }
   ImgInfo &operator=(const ImgInfo &other) {
     frame_id = other.frame_id;
     timestamp = other.timestamp;
     exposure_time = other.exposure_time;
+    device_timestamp = other.device_timestamp;
+    host_timestamp = other.host_timestamp;
     return *this;
   }
 };
 
 #define MYNTEYE_IMU_ACCEL 1
 #define MYNTEYE_IMU_GYRO 2
+#define MYNTEYE_IMU_ACCEL_GYRO 3
 
 /**
  * @ingroup datatypes
@@ -75,12 +88,16 @@ struct MYNTEYE_API ImuData {
    * Data type
    *   MYNTEYE_IMU_ACCEL: accelerometer
    *   MYNTEYE_IMU_GYRO: gyroscope
+   *   MYNTEYE_IMU_ACCEL_GYRO: both, paired at the timestamp
    * */
   std::uint8_t flag;
 
-  /** Imu gyroscope or accelerometer or frame timestamp */
+  /** Imu gyroscope or accelerometer or frame timestamp, unwrapped */
   std::uint64_t timestamp;
 
+  /** Host timestamp, in ns of std::chrono::steady_clock */
+  std::int64_t host_timestamp;
+
   /** temperature */
   double temperature;
 
@@ -93,6 +110,7 @@ struct MYNTEYE_API ImuData {
   void Reset() {
     flag = 0;
     timestamp = 0;
+    host_timestamp = 0;
     temperature = 0;
     std::fill(accel, accel + 3, 0);
     std::fill(gyro, gyro + 3, 0);
@@ -103,6 +121,92 @@ struct MYNTEYE_API ImuData {
   }
 };
 
+/**
+ * @ingroup datatypes
+ * Motion data.
+ */
+struct MYNTEYE_API MotionData {
+  /** ImuData. */
+  std::shared_ptr<ImuData> imu;
+
+  bool operator==(const MotionData &other) const {
+    if (imu && other.imu) {
+      return imu->flag == other.imu->flag &&
+             imu->timestamp == other.imu->timestamp;
+    }
+    return false;
+  }
+};
+
+/**
+ * @ingroup datatypes
+ * Imu preintegration between two timestamps, on manifold.
+ *
+ * In SI units: rad, m/s, m. The deltas are in the body frame at from, and
+ * without gravity.
+ */
+struct MYNTEYE_API ImuPreintegration {
+  /** Start timestamp, of the device */
+  std::uint64_t from;
+  /** End timestamp, of the device */
+  std::uint64_t to;
+  /** Time integrated, in seconds */
+  double dt;
+  /** Paired imu samples integrated */
+  std::uint32_t count;
+
+  /** Delta rotation */
+  double delta_rotation[3][3];
+  /** Delta velocity */
+  double delta_velocity[3];
+  /** Delta position */
+  double delta_position[3];
+  /** Covariance of delta rotation (tangent), velocity and position */
+  double covariance[9][9];
+  /** Covariance of the bias random walks, accel X, Y, Z then gyro */
+  double bias_covariance[6];
+
+  /** Accel bias subtracted, in m/s^2 */
+  double bias_accel[3];
+  /** Gyro bias subtracted, in rad/s */
+  double bias_gyro[3];
+  /** Jacobians of the deltas to the biases, to correct at first order */
+  double d_rotation_d_bias_gyro[3][3];
+  double d_velocity_d_bias_accel[3][3];
+  double d_velocity_d_bias_gyro[3][3];
+  double d_position_d_bias_accel[3][3];
+  double d_position_d_bias_gyro[3][3];
+
+  void Reset() {
+    from = 0;
+    to = 0;
+    dt = 0;
+    count = 0;
+    std::fill(&delta_rotation[0][0], &delta_rotation[0][0] + 9, 0);
+    for (int i = 0; i < 3; i++) delta_rotation[i][i] = 1;
+    std::fill(delta_velocity, delta_velocity + 3, 0);
+    std::fill(delta_position, delta_position + 3, 0);
+    std::fill(&covariance[0][0], &covariance[0][0] + 81, 0);
+    std::fill(bias_covariance, bias_covariance + 6, 0);
+    std::fill(bias_accel, bias_accel + 3, 0);
+    std::fill(bias_gyro, bias_gyro + 3, 0);
+    std::fill(&d_rotation_d_bias_gyro[0][0],
+        &d_rotation_d_bias_gyro[0][0] + 9, 0);
+    std::fill(&d_velocity_d_bias_accel[0][0],
+        &d_velocity_d_bias_accel[0][0] + 9, 0);
+    std::fill(&d_velocity_d_bias_gyro[0][0],
+        &d_velocity_d_bias_gyro[0][0] + 9, 0);
+    std::fill(&d_position_d_bias_accel[0][0],
+        &d_position_d_bias_accel[0][0] + 9, 0);
+    std::fill(&d_position_d_bias_gyro[0][0],
+        &d_position_d_bias_gyro[0][0] + 9, 0);
+  }
+
+  ImuPreintegration() {
+    Reset();
+  }
+};
+
 /**
  * @ingroup datatypes
  * Stream data.
@@ -112,6 +216,18 @@ struct MYNTEYE_API StreamData {
   std::shared_ptr<Image> img;
   /** Image information */
   std::shared_ptr<ImgInfo> img_info;
+  /**
+   * Motion datas after the previous frame till this, by the timestamps.
+   * Only if stream motion datas enabled, see
+   * Camera::EnableStreamMotionDatas().
+   */
+  std::vector<MotionData> motion_datas;
+  /**
+   * Imu preintegration after the previous frame till this, by the
+   * timestamps. Only if preintegration enabled and integrated already when
+   * the frame delivered, see Camera::EnablePreintegration().
+   */
+  std::shared_ptr<ImuPreintegration> preintegration;
 
   bool operator==(const StreamData& other) const {
     if (img_info && other.img_info) {
@@ -124,19 +240,115 @@ struct MYNTEYE_API StreamData {
 
 /**
  * @ingroup datatypes
- * Motion data.
+ * Frame set, the stream datas of one capture instant.
  */
-struct MYNTEYE_API MotionData {
-  /** ImuData. */
-  std::shared_ptr<ImuData> imu;
+struct MYNTEYE_API FrameSet {
+  /** Left color, empty if not enabled or missing */
+  StreamData left;
+  /** Right color, empty if not enabled or missing */
+  StreamData right;
+  /** Depth, empty if not enabled or missing */
+  StreamData depth;
+  /** Frame id of color if any, otherwise of depth */
+  std::int32_t frame_id;
+  /** Whether has all the stream datas enabled */
+  bool complete;
+
+  FrameSet() : frame_id(0), complete(false) {}
+};
 
-  bool operator==(const MotionData &other) const {
-    if (imu && other.imu) {
-      return imu->flag == other.imu->flag &&
-             imu->timestamp == other.imu->timestamp;
-    }
-    return false;
-  }
+/**
+ * @ingroup datatypes
+ * Options to assemble frame sets.
+ */
+struct MYNTEYE_API FrameSetOptions {
+  /**
+   * Max difference of the frame ids of color and depth in a set, default 0
+   * means the same.
+   */
+  std::uint16_t frame_id_tolerance;
+  /**
+   * Time to wait for the stream datas missing of a set, in milliseconds,
+   * default 100. Then the set is delivered without them, or dropped.
+   */
+  std::uint32_t timeout_ms;
+  /** Drop the sets not complete rather than deliver, default false */
+  bool drop_incomplete;
+
+  FrameSetOptions()
+    : frame_id_tolerance(0), timeout_ms(100), drop_incomplete(false) {}
+};
+
+/**
+ * @ingroup datatypes
+ * Stream latency, of the frames since the camera opened.
+ */
+struct MYNTEYE_API StreamLatency {
+  /** Frames delivered */
+  std::uint64_t frames;
+  /**
+   * Average time from a frame read off the device to delivered to the
+   * stream datas and callback, in microseconds. If image info synced, it
+   * includes waiting for the info.
+   */
+  double average_us;
+  /** Max time of the above, in microseconds */
+  std::uint64_t max_us;
+  /**
+   * Average time blocked reading the device per frame, in microseconds.
+   * Near 0 means frames have waited to be read.
+   */
+  double read_wait_us;
+
+  StreamLatency() : frames(0), average_us(0), max_us(0), read_wait_us(0) {}
+};
+
+/**
+ * @ingroup datatypes
+ * Stats of syncing stream data with image info, since the camera opened.
+ */
+struct MYNTEYE_API StreamSyncStats {
+  /** Frames matched with their infos */
+  std::uint64_t matched;
+  /** Frames dropped unmatched, aged out or too many pending */
+  std::uint64_t stream_orphans;
+  /** Infos dropped unmatched */
+  std::uint64_t info_orphans;
+  /**
+   * Average time the first of a frame and its info waits for the other, in
+   * microseconds.
+   */
+  double average_us;
+  /** Max time of the above, in microseconds */
+  std::uint64_t max_us;
+
+  StreamSyncStats()
+    : matched(0), stream_orphans(0), info_orphans(0), average_us(0),
+      max_us(0) {}
+};
+
+/**
+ * @ingroup datatypes
+ * Stats of the motion channel, read off the device then processed on
+ * another thread, since the camera opened.
+ */
+struct MYNTEYE_API MotionChannelStats {
+  /** Reads of data, or transfers if async */
+  std::uint64_t reads;
+  /** Reads dropped, as the processing fell behind and the queue full */
+  std::uint64_t overflows;
+  /** Imu datas dropped of the above */
+  std::uint64_t imu_dropped;
+  /** Image infos dropped of the above */
+  std::uint64_t img_info_dropped;
+  /** Packets dropped by the checksum */
+  std::uint64_t checksum_dropped;
+  /** Most reads queued to process at once */
+  std::uint64_t queued_peak;
+
+  MotionChannelStats()
+    : reads(0), overflows(0), imu_dropped(0), img_info_dropped(0),
+      checksum_dropped(0), queued_peak(0) {}
 };
 
 
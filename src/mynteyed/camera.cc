@@ -145,6 +145,26 @@ std::vector<StreamData> Camera::GetStreamDatas(const ImageType& type) {
   return std::move(p_->GetStreamDatas(type));
 }
 
+void Camera::SetFrameSetOptions(const FrameSetOptions& options) {
+  p_->SetFrameSetOptions(options);
+}
+
+FrameSet Camera::GetFrameSet() {
+  return p_->GetFrameSet();
+}
+
+StreamLatency Camera::GetStreamLatency(const ImageType& type) const {
+  return p_->GetStreamLatency(type);
+}
+
+StreamSyncStats Camera::GetStreamSyncStats(const ImageType& type) const {
+  return p_->GetStreamSyncStats(type);
+}
+
+MotionChannelStats Camera::GetMotionChannelStats() const {
+  return p_->GetMotionChannelStats();
+}
+
 bool Camera::IsMotionDatasSupported() const {
   return p_->IsMotionDatasSupported();
 }
@@ -161,10 +181,58 @@ bool Camera::IsMotionDatasEnabled() const {
   return p_->IsMotionDatasEnabled();
 }
 
+void Camera::EnableMotionPairing(std::uint32_t rate) {
+  p_->EnableMotionPairing(rate);
+}
+
+void Camera::DisableMotionPairing() {
+  p_->DisableMotionPairing();
+}
+
 std::vector<MotionData> Camera::GetMotionDatas() {
   return std::move(p_->GetMotionDatas());
 }
 
+std::vector<MotionData> Camera::GetMotionDatas(std::uint64_t from,
+    std::uint64_t to) {
+  return p_->GetMotionDatas(from, to);
+}
+
+std::size_t Camera::GetMotionDatas(std::uint64_t from, std::uint64_t to,
+    std::vector<ImuData>* datas) {
+  return p_->GetMotionDatas(from, to, datas);
+}
+
+void Camera::EnableStreamMotionDatas() {
+  p_->EnableStreamMotionDatas();
+}
+
+void Camera::DisableStreamMotionDatas() {
+  p_->DisableStreamMotionDatas();
+}
+
+void Camera::EnablePreintegration() {
+  p_->EnablePreintegration();
+}
+
+void Camera::DisablePreintegration() {
+  p_->DisablePreintegration();
+}
+
+void Camera::SetPreintegrationBias(const double (&accel)[3],
+    const double (&gyro)[3]) {
+  p_->SetPreintegrationBias(accel, gyro);
+}
+
+bool Camera::GetPreintegration(std::uint64_t from, std::uint64_t to,
+    ImuPreintegration* result) {
+  return p_->GetPreintegration(from, to, result);
+}
+
+std::int64_t Camera::GetHostTimestamp(std::uint64_t device_timestamp) const {
+  return p_->GetHostTimestamp(device_timestamp);
+}
+
 void Camera::SetImgInfoCallback(img_info_callback_t callback, bool async) {
   p_->SetImgInfoCallback(callback, async);
 }
@@ -178,6 +246,14 @@ void Camera::SetMotionCallback(motion_callback_t callback, bool async) {
   p_->SetMotionCallback(callback, async);
 }
 
+void Camera::SetMotionBatchCallback(motion_batch_callback_t callback) {
+  p_->SetMotionBatchCallback(callback);
+}
+
+void Camera::SetFrameSetCallback(frameset_callback_t callback, bool async) {
+  p_->SetFrameSetCallback(callback, async);
+}
+
 void Camera::Close() {
   p_->Close();
 }
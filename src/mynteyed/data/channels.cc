@@ -23,6 +23,9 @@
 #include <stdexcept>
 
 #include "mynteyed/data/hid/hid.h"
+#ifdef WITH_LIBUSB1
+#include "mynteyed/data/hid/hid_async.h"
+#endif
 #include "mynteyed/util/log.h"
 #include "mynteyed/util/strings.h"
 
@@ -32,11 +35,20 @@
 #define PACKET_SIZE 64
 #define DATA_SIZE 15
 
+// async transfers in flight, each of one packet to complete at once
+#define HID_ASYNC_TRANSFERS 8
+#define HID_ASYNC_EVENTS_TIMEOUT_MS 220
+// reads queued to process at most, the new ones dropped over it
+#define HID_DATAS_QUEUE_SIZE 128
+// wait for reads to process at most, in case
+#define HID_PROCESS_WAIT_MS 100
+
 MYNTEYE_BEGIN_NAMESPACE
 
 namespace {
 
-inline std::uint8_t check_sum(std::uint8_t *buf, std::uint16_t length) {
+inline std::uint8_t check_sum(const std::uint8_t *buf,
+    std::uint16_t length) {
   std::uint8_t crc8 = 0;
   while (length--) {
     crc8 = crc8 ^ (*buf++);
@@ -66,9 +78,28 @@ void CheckSpecVersion(const Version *spec_version) {
       ss.str().c_str());
 }
 
+// Files go through the sync reads, so pauses the async tracking meanwhile
+class HidAsyncPause {
+ public:
+  explicit HidAsyncPause(Channels *channels)
+    : channels_(channels),
+      paused_(channels->IsHidTracking() && channels->IsHidAsync()) {
+    if (paused_) channels_->StopHidTracking();
+  }
+  ~HidAsyncPause() {
+    if (paused_) channels_->StartHidTracking();
+  }
+
+ private:
+  Channels *channels_;
+  bool paused_;
+};
+
 }  // namespace
 
-Channels::Channels() : imu_callback_(nullptr), img_callback_(nullptr) {
+Channels::Channels() : imu_callback_(nullptr), img_callback_(nullptr),
+    clock_sync_(std::make_shared<ClockSync>()),
+    hid_datas_(HID_DATAS_QUEUE_SIZE) {
   hid_ = std::make_shared<hid::hid_device>();
   Detect();
   Open();
@@ -89,7 +120,7 @@ bool Channels::IsOpened() const {
   return IsHidOpened();
 }
 
-void Channels::SetImuDataCallback(imu_callback_t callback) {
+void Channels::SetImuDatasCallback(imu_callback_t callback) {
   imu_callback_ = callback;
 }
 
@@ -97,6 +128,21 @@ void Channels::SetImgInfoCallback(img_callback_t callback) {
   img_callback_ = callback;
 }
 
+std::shared_ptr<ClockSync> Channels::GetClockSync() const {
+  return clock_sync_;
+}
+
+MotionChannelStats Channels::GetStats() const {
+  MotionChannelStats stats;
+  stats.reads = reads_.load(std::memory_order_relaxed);
+  stats.overflows = overflows_.load(std::memory_order_relaxed);
+  stats.imu_dropped = imu_dropped_.load(std::memory_order_relaxed);
+  stats.img_info_dropped = img_dropped_.load(std::memory_order_relaxed);
+  stats.checksum_dropped = checksum_dropped_.load(std::memory_order_relaxed);
+  stats.queued_peak = queued_peak_.load(std::memory_order_relaxed);
+  return stats;
+}
+
 bool Channels::IsHidAvaliable() const {
   return is_hid_exist_;
 }
@@ -109,6 +155,10 @@ bool Channels::IsHidTracking() const {
   return is_hid_tracking_;
 }
 
+bool Channels::IsHidAsync() const {
+  return is_hid_async_;
+}
+
 bool Channels::StartHidTracking() {
   if (!is_hid_opened_) {
     LOGW("WARNING:: hid device was not opened.");
@@ -119,6 +169,10 @@ bool Channels::StartHidTracking() {
     return true;
   }
 
+  StartHidProcessing();
+  // reads sync if could not async
+  StartHidAsync();
+
   is_hid_tracking_ = true;
   hid_track_thread_ = std::thread([this]() {
     while (is_hid_tracking_) {
@@ -143,6 +197,8 @@ bool Channels::StopHidTracking() {
   if (hid_track_thread_.joinable()) {
     hid_track_thread_.join();
   }
+  StopHidAsync();
+  StopHidProcessing();
   return true;
 }
 
@@ -188,23 +244,153 @@ void Channels::CloseHid() {
   is_hid_opened_ = false;
 }
 
+bool Channels::StartHidAsync() {
+#ifdef WITH_LIBUSB1
+  if (is_hid_async_) {
+    return true;
+  }
+  // the interface could be claimed by one handle only
+  if (hid_->release(0) < 0) {
+    return false;
+  }
+  if (!hid_async_) {
+    hid_async_ = std::make_shared<hid::hid_async_reader>();
+  }
+  // parse in the completion handler, on the thread of hid tracking
+  bool ok = hid_async_->start([this](const std::uint8_t *data, int size,
+      std::int64_t host_time) {
+    DoHidDataPut(data, size, host_time);
+  }, HID_ASYNC_TRANSFERS, PACKET_SIZE);
+  if (!ok) {
+    LOGW("WARNING:: hid device could not read async, reads sync instead.");
+    hid_->claim(0);
+    return false;
+  }
+  is_hid_async_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Channels::StopHidAsync() {
+#ifdef WITH_LIBUSB1
+  if (!is_hid_async_) {
+    return;
+  }
+  hid_async_->stop();
+  is_hid_async_ = false;
+  if (hid_->claim(0) < 0) {
+    // degraded: neither async nor sync reads, till the device reopened
+    LOGE("%s, %d:: Claim hid device back failed, motion datas and image "
+        "infos could not be read until reopened.", __FILE__, __LINE__);
+  }
+#endif
+}
+
 void Channels::DoHidTrack() {
-  static imu_packets_t imu_packets;
-  static img_packets_t img_packets;
-  imu_packets.clear();
-  img_packets.clear();
+#ifdef WITH_LIBUSB1
+  if (is_hid_async_) {
+    if (!hid_async_->handle_events(HID_ASYNC_EVENTS_TIMEOUT_MS)) {
+      LOGE("Error:: Reading async, device went offline !");
+      // fall back to the sync reads
+      StopHidAsync();
+    }
+    return;
+  }
+#endif
+
+  DoHidDataExtract();
+}
+
+void Channels::StartHidProcessing() {
+  if (is_hid_processing_) {
+    return;
+  }
+  is_hid_processing_ = true;
+  hid_process_thread_ = std::thread(&Channels::DoHidProcess, this);
+}
+
+void Channels::StopHidProcessing() {
+  if (!is_hid_processing_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> _(hid_process_mutex_);
+    is_hid_processing_ = false;
+  }
+  hid_process_condition_.notify_one();
+  if (hid_process_thread_.joinable()) {
+    hid_process_thread_.join();
+  }
+}
+
+void Channels::DoHidDataPut(const std::uint8_t *data, int size,
+    std::int64_t host_time) {
+  // parsed even if full, as the timestamps unwrapped by each
+  HidDatas *datas = hid_datas_.back();
+  auto &&imu = datas ? datas->imu : imu_packets_;
+  auto &&img = datas ? datas->img : img_packets_;
+  imu.clear();
+  img.clear();
+  DoHidDataParse(data, size, host_time, imu, img);
+  if (imu.empty() && img.empty()) {
+    return;
+  }
 
-  if (!DoHidDataExtract(imu_packets, img_packets)) {
+  reads_.fetch_add(1, std::memory_order_relaxed);
+  if (!datas) {
+    overflows_.fetch_add(1, std::memory_order_relaxed);
+    imu_dropped_.fetch_add(imu.size(), std::memory_order_relaxed);
+    img_dropped_.fetch_add(img.size(), std::memory_order_relaxed);
     return;
   }
+  hid_datas_.push_back();
+  std::uint64_t queued = hid_datas_.size();
+  if (queued > queued_peak_.load(std::memory_order_relaxed)) {
+    queued_peak_.store(queued, std::memory_order_relaxed);
+  }
+
+  // pushed before checking waiting, while the processing sets waiting before
+  // checking empty, so either it sees the datas or is notified
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_hid_process_waiting_.load(std::memory_order_relaxed)) {
+    // held by the processing only till it waits
+    std::lock_guard<std::mutex> _(hid_process_mutex_);
+    hid_process_condition_.notify_one();
+  }
+}
 
-  if (imu_callback_) {
-    for (auto &&imu_packet : imu_packets) {
-      imu_callback_(imu_packet);
+void Channels::DoHidProcess() {
+  while (true) {
+    HidDatas *datas = hid_datas_.front();
+    if (datas) {
+      DoHidDataCallback(datas->imu, datas->img);
+      hid_datas_.pop_front();
+      continue;
+    }
+    // stops after the ones queued processed
+    if (!is_hid_processing_) {
+      break;
     }
+    std::unique_lock<std::mutex> lock(hid_process_mutex_);
+    is_hid_process_waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    hid_process_condition_.wait_for(lock,
+        std::chrono::milliseconds(HID_PROCESS_WAIT_MS), [this]() {
+      return !hid_datas_.empty() || !is_hid_processing_;
+    });
+    is_hid_process_waiting_.store(false, std::memory_order_relaxed);
+  }
+}
+
+void Channels::DoHidDataCallback(const imu_packets_t &imu,
+    const img_packets_t &img) {
+  if (imu_callback_ && !imu.empty()) {
+    imu_callback_(imu);
   }
   if (img_callback_) {
-    for (auto &&img_packet : img_packets) {
+    for (auto &&img_packet : img) {
       img_callback_(img_packet);
     }
   }
@@ -276,7 +462,7 @@ void detect_img_info_stamp(const ImgInfoPacket& img_info) {
 }
 #endif
 
-bool Channels::DoHidDataExtract(imu_packets_t &imu, img_packets_t &img) {
+bool Channels::DoHidDataExtract() {
   std::uint8_t data[PACKET_SIZE * 2]{};
   std::fill(data, data + PACKET_SIZE * 2, 0);
 
@@ -285,12 +471,19 @@ bool Channels::DoHidDataExtract(imu_packets_t &imu, img_packets_t &img) {
     LOGE("Error:: Reading, device went offline !");
     return false;
   }
+  // the least latency of a read is its last data, the envelope keeps it
+  DoHidDataPut(data, size, ClockSync::Now());
+  return true;
+}
 
+void Channels::DoHidDataParse(const std::uint8_t *data, int size,
+    std::int64_t host_time, imu_packets_t &imu, img_packets_t &img) {
   for (int i = 0; i < size / PACKET_SIZE; i++) {
-    std::uint8_t *packet = data + i * PACKET_SIZE;
+    const std::uint8_t *packet = data + i * PACKET_SIZE;
 
     if (packet[PACKET_SIZE - 1] !=
         check_sum(&packet[3], packet[2])) {
+      checksum_dropped_.fetch_add(1, std::memory_order_relaxed);
       LOGW("check droped.");
       continue;
     }
@@ -319,6 +512,11 @@ bool Channels::DoHidDataExtract(imu_packets_t &imu, img_packets_t &img) {
       std::uint8_t header = *(packet + offset);
       if (header == 0 || header == 1) {
         auto&& imu_data = ImuDataPacket(packet + offset);
+        imu_data.device_timestamp =
+            clock_sync_->Unwrap(imu_data.timestamp, host_time);
+        clock_sync_->Put(imu_data.device_timestamp, host_time);
+        imu_data.host_timestamp =
+            clock_sync_->ToHost(imu_data.device_timestamp);
         imu.push_back(imu_data);
 #ifdef PACKET_PRINT
         print_imu_data(imu_data);
@@ -328,6 +526,11 @@ bool Channels::DoHidDataExtract(imu_packets_t &imu, img_packets_t &img) {
 #endif
       } else if (header == 2) {
         auto&& img_info = ImgInfoPacket(packet + offset);
+        img_info.device_timestamp =
+            clock_sync_->Unwrap(img_info.timestamp, host_time);
+        clock_sync_->Put(img_info.device_timestamp, host_time);
+        img_info.host_timestamp =
+            clock_sync_->ToHost(img_info.device_timestamp);
         img.push_back(img_info);
 #ifdef PACKET_PRINT
         print_img_info(img_info);
@@ -338,8 +541,6 @@ bool Channels::DoHidDataExtract(imu_packets_t &imu, img_packets_t &img) {
       }
     }
   }
-
-  return true;
 }
 
 namespace {
@@ -584,6 +785,7 @@ bool Channels::GetFiles(device_desc_t *desc,
   std::uint8_t data[2000]{};
   std::uint16_t file_len;
 
+  HidAsyncPause pause(this);
   if (!PullFileData(true, true, true, data, file_len)) {
     LOGE("%s %d:: GetFiles failed.", __FILE__, __LINE__);
     return false;
@@ -921,6 +1123,7 @@ bool Channels::SetFiles(device_desc_t *desc,
   data[size + 3] = check_sum(data + 3, size);
   size += 4;
 
+  HidAsyncPause pause(this);
   if (!PushFileData(data, size)) {
     LOGE("%s %d:: Update file data failure.",
         __FILE__, __LINE__);
@@ -15,20 +15,26 @@
 #define MYNTEYE_DATA_CHANNELS_H_
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "mynteyed/data/clock_sync.h"
 #include "mynteyed/data/types_internal.h"
 #include "mynteyed/types_data.h"
+#include "mynteyed/util/spsc_ring.h"
 
 MYNTEYE_BEGIN_NAMESPACE
 
 namespace hid {
 
 class hid_device;
+class hid_async_reader;
 
 }  // namespace hid
 
@@ -47,7 +53,8 @@ class MYNTEYE_API Channels {
   using imu_packets_t = std::vector<ImuDataPacket>;
   using img_packets_t = std::vector<ImgInfoPacket>;
 
-  using imu_callback_t = std::function<void(const ImuDataPacket &packet)>;
+  // imu packets of one hid read
+  using imu_callback_t = std::function<void(const imu_packets_t &packets)>;
   using img_callback_t = std::function<void(const ImgInfoPacket &packet)>;
 
   Channels();
@@ -56,12 +63,14 @@ class MYNTEYE_API Channels {
   bool IsAvaliable() const;
   bool IsOpened() const;
 
-  void SetImuDataCallback(imu_callback_t callback);
+  void SetImuDatasCallback(imu_callback_t callback);
   void SetImgInfoCallback(img_callback_t callback);
 
   bool IsHidAvaliable() const;
   bool IsHidOpened() const;
   bool IsHidTracking() const;
+  // Whether tracking with the async reader, otherwise the sync reads
+  bool IsHidAsync() const;
 
   bool StartHidTracking();
   bool StopHidTracking();
@@ -76,6 +85,11 @@ class MYNTEYE_API Channels {
 
   bool IsBetaDevice() const;
 
+  // The device clock synced to the host, of the packets tracked
+  std::shared_ptr<ClockSync> GetClockSync() const;
+
+  MotionChannelStats GetStats() const;
+
  protected:
   void Detect();
   bool Open();
@@ -86,8 +100,22 @@ class MYNTEYE_API Channels {
   void CloseHid();
 
  private:
+  bool StartHidAsync();
+  void StopHidAsync();
+
+  void StartHidProcessing();
+  void StopHidProcessing();
+
   void DoHidTrack();
-  bool DoHidDataExtract(imu_packets_t &imu, img_packets_t &img);  // NOLINT
+  bool DoHidDataExtract();
+  // Parses the data read, and queues the packets to process
+  void DoHidDataPut(const std::uint8_t *data, int size,
+      std::int64_t host_time);
+  void DoHidDataParse(const std::uint8_t *data, int size,
+      std::int64_t host_time,
+      imu_packets_t &imu, img_packets_t &img);  // NOLINT
+  void DoHidProcess();
+  void DoHidDataCallback(const imu_packets_t &imu, const img_packets_t &img);
 
   bool PullFileData(bool device_info,
       bool reserve,
@@ -97,16 +125,48 @@ class MYNTEYE_API Channels {
   bool PushFileData(std::uint8_t *data, std::uint16_t size);
 
   std::shared_ptr<hid::hid_device> hid_;
+  std::shared_ptr<hid::hid_async_reader> hid_async_;
 
   bool is_hid_exist_ = false;
   bool is_hid_opened_ = false;
-  bool is_hid_tracking_ = false;
+  // Read on the thread of hid tracking, set on the caller's
+  std::atomic<bool> is_hid_tracking_{false};
+  std::atomic<bool> is_hid_async_{false};
 
   imu_callback_t imu_callback_;
   img_callback_t img_callback_;
 
   std::thread hid_track_thread_;
 
+  // Parsed into if the queue full, only on the thread of hid tracking
+  imu_packets_t imu_packets_;
+  img_packets_t img_packets_;
+
+  std::shared_ptr<ClockSync> clock_sync_;
+
+  // The packets of each read, from hid tracking to the processing. The
+  // callbacks run on the processing, so never delay the next read.
+  struct HidDatas {
+    imu_packets_t imu;
+    img_packets_t img;
+  };
+  SpscRing<HidDatas> hid_datas_;
+
+  std::atomic<bool> is_hid_processing_{false};
+  std::thread hid_process_thread_;
+  // Notified only if the processing waits
+  std::atomic<bool> is_hid_process_waiting_{false};
+  std::mutex hid_process_mutex_;
+  std::condition_variable hid_process_condition_;
+
+  // Written on the thread of hid tracking only
+  std::atomic<std::uint64_t> reads_{0};
+  std::atomic<std::uint64_t> overflows_{0};
+  std::atomic<std::uint64_t> imu_dropped_{0};
+  std::atomic<std::uint64_t> img_dropped_{0};
+  std::atomic<std::uint64_t> checksum_dropped_{0};
+  std::atomic<std::uint64_t> queued_peak_{0};
+
   std::uint16_t package_sn_ = 0;
 };
 
@@ -0,0 +1,207 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/data/clock_sync.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// device timestamps in 0.01ms
+#define CLOCK_SYNC_NOMINAL_RATE 10000.  // ns per tick
+// each window keeps the packet of the least latency
+#define CLOCK_SYNC_WINDOW_TICKS 100000  // 1s
+#define CLOCK_SYNC_WINDOWS_MAX_SIZE 60
+// larger backward, or forward beyond the host time elapsed, as the device
+// reset, rather than packets out of order or delayed
+#define CLOCK_SYNC_RESET_TICKS 100000  // 1s
+// residuals within are never outliers
+#define CLOCK_SYNC_OUTLIER_MIN_NS 100000  // 0.1ms
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+// Least squares of y = a + b * x
+void fit_line(const std::vector<double>& x, const std::vector<double>& y,
+    const std::vector<bool>& used, double* a, double* b) {
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (std::size_t i = 0; i < x.size(); i++) {
+    if (!used[i]) continue;
+    n += 1;
+    sx += x[i];
+    sy += y[i];
+    sxx += x[i] * x[i];
+    sxy += x[i] * y[i];
+  }
+  double d = n * sxx - sx * sx;
+  if (n < 2 || std::fabs(d) < 1e-9) {
+    *b = CLOCK_SYNC_NOMINAL_RATE;
+    *a = n > 0 ? (sy - *b * sx) / n : 0;
+    return;
+  }
+  *b = (n * sxy - sx * sy) / d;
+  *a = (sy - *b * sx) / n;
+}
+
+double median(std::vector<double> values) {
+  auto&& mid = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), mid, values.end());
+  return *mid;
+}
+
+}  // namespace
+
+ClockSync::ClockSync() {
+  Reset();
+}
+
+std::int64_t ClockSync::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint64_t ClockSync::Unwrap(std::uint32_t timestamp,
+    std::int64_t host_time) {
+  if (!has_last_) {
+    has_last_ = true;
+    last_ = timestamp;
+    last_host_time_ = host_time;
+    unwrapped_ = timestamp;
+    return unwrapped_;
+  }
+  // forward modulo 2^32, small backward if out of order
+  std::int32_t delta = static_cast<std::int32_t>(timestamp - last_);
+  // the device could not run ahead of the host; if it reset after 2^31
+  // ticks, the delta is forward of hours instead
+  auto&& elapsed = static_cast<std::int64_t>(std::max<std::int64_t>(
+      host_time - last_host_time_, 0) / CLOCK_SYNC_NOMINAL_RATE);
+  last_ = timestamp;
+  last_host_time_ = host_time;
+  if (delta < -CLOCK_SYNC_RESET_TICKS ||
+      delta - elapsed > CLOCK_SYNC_RESET_TICKS) {
+    // the device reset, keep monotonic but fit again
+    ++unwrapped_;
+    windows_.clear();
+    has_window_ = false;
+    std::lock_guard<std::mutex> _(mutex_);
+    has_fit_ = false;
+    return unwrapped_;
+  }
+  unwrapped_ += delta;
+  return unwrapped_;
+}
+
+void ClockSync::Put(std::uint64_t timestamp, std::int64_t host_time) {
+  Sample sample{timestamp, host_time};
+  if (has_window_ && timestamp >= window_end_) {
+    windows_.push_back(window_);
+    if (windows_.size() > CLOCK_SYNC_WINDOWS_MAX_SIZE) {
+      windows_.pop_front();
+    }
+    has_window_ = false;
+    Refit();
+  }
+  if (!has_window_) {
+    has_window_ = true;
+    window_ = sample;
+    window_end_ = timestamp + CLOCK_SYNC_WINDOW_TICKS;
+  } else {
+    // least latency by the nominal rate, drift negligible in a window
+    auto&& latency = host_time - window_.host_time
+        - CLOCK_SYNC_NOMINAL_RATE * (static_cast<std::int64_t>(timestamp)
+            - static_cast<std::int64_t>(window_.timestamp));
+    if (latency < 0) window_ = sample;
+  }
+  if (windows_.size() < 2) {
+    // offset only of the least latency so far, till it could fit
+    Sample best = window_;
+    for (auto&& window : windows_) {
+      auto&& latency = best.host_time - window.host_time
+          - CLOCK_SYNC_NOMINAL_RATE * (static_cast<std::int64_t>(best.timestamp)
+              - static_cast<std::int64_t>(window.timestamp));
+      if (latency > 0) best = window;
+    }
+    std::lock_guard<std::mutex> _(mutex_);
+    has_fit_ = true;
+    origin_ = best.timestamp;
+    host_origin_ = best.host_time;
+    rate_ = CLOCK_SYNC_NOMINAL_RATE;
+  }
+}
+
+std::int64_t ClockSync::ToHost(std::uint64_t timestamp) const {
+  std::lock_guard<std::mutex> _(mutex_);
+  if (!has_fit_) return 0;
+  auto&& ticks = static_cast<double>(static_cast<std::int64_t>(
+      timestamp - origin_));
+  return host_origin_ + std::llround(rate_ * ticks);
+}
+
+void ClockSync::Reset() {
+  has_last_ = false;
+  last_ = 0;
+  last_host_time_ = 0;
+  unwrapped_ = 0;
+  windows_.clear();
+  has_window_ = false;
+  window_end_ = 0;
+  std::lock_guard<std::mutex> _(mutex_);
+  has_fit_ = false;
+  origin_ = 0;
+  host_origin_ = 0;
+  rate_ = CLOCK_SYNC_NOMINAL_RATE;
+}
+
+void ClockSync::Refit() {
+  if (windows_.size() < 2) return;
+  auto&& origin = windows_.front();
+  std::vector<double> x, y;
+  for (auto&& window : windows_) {
+    x.push_back(static_cast<double>(window.timestamp - origin.timestamp));
+    y.push_back(static_cast<double>(window.host_time - origin.host_time));
+  }
+  std::vector<bool> used(x.size(), true);
+  double a, b;
+  fit_line(x, y, used, &a, &b);
+
+  // reject the ones far off, by the median absolute deviation
+  std::vector<double> residuals;
+  for (std::size_t i = 0; i < x.size(); i++) {
+    residuals.push_back(y[i] - (a + b * x[i]));
+  }
+  double med = median(residuals);
+  std::vector<double> deviations;
+  for (auto&& residual : residuals) {
+    deviations.push_back(std::fabs(residual - med));
+  }
+  double threshold = std::max(3 * 1.4826 * median(deviations),
+      static_cast<double>(CLOCK_SYNC_OUTLIER_MIN_NS));
+  bool rejected = false;
+  for (std::size_t i = 0; i < x.size(); i++) {
+    if (std::fabs(residuals[i] - med) > threshold) {
+      used[i] = false;
+      rejected = true;
+    }
+  }
+  if (rejected) fit_line(x, y, used, &a, &b);
+
+  std::lock_guard<std::mutex> _(mutex_);
+  has_fit_ = true;
+  origin_ = origin.timestamp;
+  host_origin_ = origin.host_time + std::llround(a);
+  rate_ = b;
+}
+
+MYNTEYE_END_NAMESPACE
@@ -0,0 +1,83 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_DATA_CLOCK_SYNC_H_
+#define MYNTEYE_DATA_CLOCK_SYNC_H_
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Syncs the device clock to the host, of the hid packets.
+ *
+ * The 32-bit device timestamps, in 0.01ms, are unwrapped into monotonic
+ * 64-bit ones. The host time is fitted linearly to them, i.e. offset and
+ * drift, over the recent windows. Each window keeps the packet of the least
+ * latency to the host, so the fit follows the lower envelope and the delays
+ * of transfer or scheduling do not bias it. Outliers are rejected once.
+ */
+class ClockSync {
+ public:
+  ClockSync();
+
+  // Host time now, in nanoseconds of std::chrono::steady_clock
+  static std::int64_t Now();
+
+  // Unwraps the device timestamp received at the host time, on the thread
+  // of channels. The host time tells the device reset from a long forward.
+  std::uint64_t Unwrap(std::uint32_t timestamp, std::int64_t host_time);
+  // Puts the unwrapped device timestamp received at the host time, on the
+  // thread of channels
+  void Put(std::uint64_t timestamp, std::int64_t host_time);
+
+  // Host time of the unwrapped device timestamp, 0 if none put yet
+  std::int64_t ToHost(std::uint64_t timestamp) const;
+
+  void Reset();
+
+ private:
+  struct Sample {
+    std::uint64_t timestamp;
+    std::int64_t host_time;
+  };
+
+  void Refit();
+
+  bool has_last_;
+  std::uint32_t last_;
+  std::int64_t last_host_time_;
+  std::uint64_t unwrapped_;
+
+  // Least latency of each window
+  std::deque<Sample> windows_;
+  bool has_window_;
+  Sample window_;
+  std::uint64_t window_end_;
+
+  // host_time = host_origin_ + rate_ * (timestamp - origin_)
+  mutable std::mutex mutex_;
+  bool has_fit_;
+  std::uint64_t origin_;
+  std::int64_t host_origin_;
+  double rate_;
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_DATA_CLOCK_SYNC_H_
@@ -74,6 +74,11 @@ class hid_device {
   void droped();
   int get_device_class();
   bool find_device();
+#ifdef MYNTEYE_OS_LINUX
+  // Releases the interface for another handle to claim, then claims it back
+  int release(int num);
+  int claim(int num);
+#endif
 
  protected:
   void add_hid(hid_t *hid);
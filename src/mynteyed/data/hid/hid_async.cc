@@ -0,0 +1,252 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/data/hid/hid_async.h"
+
+#include <libusb.h>
+
+#include "mynteyed/data/clock_sync.h"
+#include "mynteyed/data/hid/hid.h"
+#include "mynteyed/util/log.h"
+
+// how long to wait the transfers cancelled when stop
+#define HID_ASYNC_CANCEL_TIMEOUT_MS 1000
+#define HID_ASYNC_CANCEL_WAIT_MS 100
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace hid {
+
+hid_async_reader::hid_async_reader() :
+  context_(nullptr),
+  handle_(nullptr),
+  iface_(-1),
+  endpoint_(0),
+  interrupt_(false),
+  callback_(nullptr),
+  in_flight_(0),
+  started_(false),
+  failed_(false) {
+}
+
+hid_async_reader::~hid_async_reader() {
+  stop();
+}
+
+bool hid_async_reader::start(callback_t callback, int transfers,
+    int transfer_size) {
+  if (started_) {
+    return true;
+  }
+  if (transfers < 1 || transfer_size < 1) {
+    return false;
+  }
+  if (!open_device()) {
+    close_device();
+    return false;
+  }
+
+  callback_ = callback;
+  failed_ = false;
+  for (int i = 0; i < transfers; i++) {
+    libusb_transfer *transfer = libusb_alloc_transfer(0);
+    if (!transfer) {
+      break;
+    }
+    buffers_.emplace_back(transfer_size);
+    transfers_.push_back(transfer);
+    if (interrupt_) {
+      libusb_fill_interrupt_transfer(transfer, handle_, endpoint_,
+          buffers_.back().data(), transfer_size, on_transfer, this, 0);
+    } else {
+      libusb_fill_bulk_transfer(transfer, handle_, endpoint_,
+          buffers_.back().data(), transfer_size, on_transfer, this, 0);
+    }
+  }
+
+  // started before submitted, as they may complete at once
+  started_ = true;
+  for (auto &&transfer : transfers_) {
+    int ret = libusb_submit_transfer(transfer);
+    if (ret < 0) {
+      LOGW("WARNING:: Submit hid transfer failed, %s", libusb_error_name(ret));
+      continue;
+    }
+    ++in_flight_;
+  }
+  if (in_flight_ == 0) {
+    stop();
+    return false;
+  }
+  return true;
+}
+
+void hid_async_reader::stop() {
+  if (!context_) {
+    return;
+  }
+  started_ = false;
+  for (auto &&transfer : transfers_) {
+    // fails if not in flight, ignored
+    libusb_cancel_transfer(transfer);
+  }
+  for (int waited = 0; in_flight_ > 0 && waited < HID_ASYNC_CANCEL_TIMEOUT_MS;
+      waited += HID_ASYNC_CANCEL_WAIT_MS) {
+    struct timeval tv = {0, HID_ASYNC_CANCEL_WAIT_MS * 1000};
+    if (libusb_handle_events_timeout_completed(context_, &tv, nullptr) < 0) {
+      break;
+    }
+  }
+  if (in_flight_ > 0) {
+    // could not free the ones in flight, leaked; closing the handle discards
+    // them, so still release the interface and close
+    LOGW("WARNING:: %d hid transfers not cancelled.", in_flight_);
+    transfers_.clear();
+    in_flight_ = 0;
+  } else {
+    free_transfers();
+  }
+  close_device();
+  buffers_.clear();
+}
+
+bool hid_async_reader::is_started() const {
+  return started_;
+}
+
+bool hid_async_reader::handle_events(int timeout_ms) {
+  if (!started_) {
+    return false;
+  }
+  struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+  int ret = libusb_handle_events_timeout_completed(context_, &tv, nullptr);
+  if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+    LOGE("Error:: Handle hid transfers failed, %s", libusb_error_name(ret));
+    return false;
+  }
+  return !failed_ && in_flight_ > 0;
+}
+
+void hid_async_reader::on_transfer(libusb_transfer *transfer) {
+  auto reader = static_cast<hid_async_reader *>(transfer->user_data);
+  auto host_time = ClockSync::Now();
+  switch (transfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+      if (reader->started_ && reader->callback_ &&
+          transfer->actual_length > 0) {
+        reader->callback_(transfer->buffer, transfer->actual_length,
+            host_time);
+      }
+      break;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+      break;
+    case LIBUSB_TRANSFER_CANCELLED:
+      --reader->in_flight_;
+      return;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+      reader->failed_ = true;
+      --reader->in_flight_;
+      return;
+    default:
+      // error, stall or overflow, drop this one
+      LOGW("WARNING:: Hid transfer failed, status %d", transfer->status);
+      --reader->in_flight_;
+      return;
+  }
+  if (!reader->started_ || libusb_submit_transfer(transfer) < 0) {
+    --reader->in_flight_;
+  }
+}
+
+bool hid_async_reader::open_device() {
+  int ret = libusb_init(&context_);
+  if (ret < 0) {
+    LOGW("WARNING:: Init libusb failed, %s", libusb_error_name(ret));
+    context_ = nullptr;
+    return false;
+  }
+  handle_ = libusb_open_device_with_vid_pid(context_, VID, PID);
+  if (!handle_) {
+    return false;
+  }
+
+  libusb_config_descriptor *config = nullptr;
+  if (libusb_get_active_config_descriptor(libusb_get_device(handle_),
+      &config) < 0) {
+    return false;
+  }
+  // the generic hid interface, the same of hid_device
+  iface_ = -1;
+  for (int i = 0; i < config->bNumInterfaces && iface_ < 0; i++) {
+    if (config->interface[i].num_altsetting < 1) {
+      continue;
+    }
+    auto &&desc = config->interface[i].altsetting[0];
+    if (LIBUSB_CLASS_HID != desc.bInterfaceClass ||
+        0 != desc.bInterfaceSubClass ||
+        0 != desc.bInterfaceProtocol)
+      continue;
+    for (int n = 0; n < desc.bNumEndpoints; n++) {
+      auto &&endp = desc.endpoint[n];
+      if (endp.bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+        iface_ = desc.bInterfaceNumber;
+        endpoint_ = endp.bEndpointAddress;
+        interrupt_ = (endp.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) ==
+            LIBUSB_TRANSFER_TYPE_INTERRUPT;
+        break;
+      }
+    }
+  }
+  libusb_free_config_descriptor(config);
+  if (iface_ < 0) {
+    return false;
+  }
+
+  // detached by hid_device already mostly, not supported on some platforms
+  libusb_set_auto_detach_kernel_driver(handle_, 1);
+  ret = libusb_claim_interface(handle_, iface_);
+  if (ret < 0) {
+    LOGW("WARNING:: Claim hid interface %d failed, %s", iface_,
+        libusb_error_name(ret));
+    iface_ = -1;
+    return false;
+  }
+  return true;
+}
+
+void hid_async_reader::close_device() {
+  if (handle_) {
+    if (iface_ >= 0) {
+      libusb_release_interface(handle_, iface_);
+    }
+    libusb_close(handle_);
+    handle_ = nullptr;
+  }
+  iface_ = -1;
+  if (context_) {
+    libusb_exit(context_);
+    context_ = nullptr;
+  }
+}
+
+void hid_async_reader::free_transfers() {
+  for (auto &&transfer : transfers_) {
+    libusb_free_transfer(transfer);
+  }
+  transfers_.clear();
+  buffers_.clear();
+}
+
+}  // namespace hid
+
+MYNTEYE_END_NAMESPACE
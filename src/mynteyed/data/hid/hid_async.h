@@ -0,0 +1,86 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_DATA_HID_HID_ASYNC_H_
+#define MYNTEYE_DATA_HID_HID_ASYNC_H_
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+struct libusb_context;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace hid {
+
+/**
+ * Reads the hid with libusb-1.0, keeping several transfers in flight.
+ *
+ * The device keeps sending while a transfer is handled, as the others are
+ * queued already, so no packets wait for the next read. Each transfer
+ * completes with the host time it arrived, and is submitted again after
+ * the callback.
+ */
+class hid_async_reader {
+ public:
+  // data of a transfer completed, and the host time in ns it arrived
+  using callback_t = std::function<void(const std::uint8_t *data, int size,
+      std::int64_t host_time)>;
+
+  hid_async_reader();
+  virtual ~hid_async_reader();
+
+  // Claims the hid interface of the device, and submits the transfers.
+  // The interface must be released by others first. False if failed.
+  bool start(callback_t callback, int transfers, int transfer_size);
+  // Cancels the transfers, and releases the interface
+  void stop();
+  bool is_started() const;
+
+  // Handles the transfers completed till timeout, the callback is called on
+  // this thread. False if the device went offline or all transfers failed.
+  bool handle_events(int timeout_ms);
+
+ private:
+  static void on_transfer(libusb_transfer *transfer);
+
+  bool open_device();
+  void close_device();
+  void free_transfers();
+
+  libusb_context *context_;
+  libusb_device_handle *handle_;
+  int iface_;
+  unsigned char endpoint_;
+  bool interrupt_;
+
+  callback_t callback_;
+  std::vector<libusb_transfer *> transfers_;
+  std::vector<std::vector<std::uint8_t>> buffers_;
+  // Submitted and not completed yet
+  int in_flight_;
+  bool started_;
+  bool failed_;
+};
+
+}  // namespace hid
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_DATA_HID_HID_ASYNC_H_
@@ -83,6 +83,42 @@ int hid_device::send(int num, void *buf, int len, int timeout) {
   }
 }
 
+/**
+ * release - release the interface of a device, still opened
+ *
+ * Inputs:
+ * num = device to release (zero based)
+ *
+ * Outputs:
+ * 0 on success, or < 0 on error
+ */
+int hid_device::release(int num) {
+  hid_t *hid = get_hid(num);
+
+  if (!hid || !hid->open) {
+    return -1;
+  }
+  return usb_release_interface(hid->usb, hid->iface);
+}
+
+/**
+ * claim - claim the interface of a device released
+ *
+ * Inputs:
+ * num = device to claim (zero based)
+ *
+ * Outputs:
+ * 0 on success, or < 0 on error
+ */
+int hid_device::claim(int num) {
+  hid_t *hid = get_hid(num);
+
+  if (!hid || !hid->open) {
+    return -1;
+  }
+  return usb_claim_interface(hid->usb, hid->iface);
+}
+
 /**
  * open - open 1 or more devices
  *
@@ -31,13 +31,16 @@ struct ImgInfoPacket {
   std::uint16_t frame_id;
   std::uint32_t timestamp;
   std::uint16_t exposure_time;
+  // Set by channels: unwrapped timestamp, and host time in ns of it
+  std::uint64_t device_timestamp;
+  std::int64_t host_timestamp;
 
   ImgInfoPacket() = default;
-  explicit ImgInfoPacket(std::uint8_t *data) {
+  explicit ImgInfoPacket(const std::uint8_t *data) {
     from_data(data);
   }
 
-  void from_data(std::uint8_t *data) {
+  void from_data(const std::uint8_t *data) {
     timestamp = (*(data + 2)) | (*(data + 3) << 8) | (*(data + 4) << 16) |
                 (*(data + 5) << 24);
     frame_id = (*(data + 6)) | (*(data + 7) << 8);
@@ -56,13 +59,16 @@ struct ImuDataPacket {
   std::uint32_t timestamp;
   std::int16_t temperature;
   std::int16_t accel_or_gyro[3];
+  // Set by channels: unwrapped timestamp, and host time in ns of it
+  std::uint64_t device_timestamp;
+  std::int64_t host_timestamp;
 
   ImuDataPacket() = default;
-  explicit ImuDataPacket(std::uint8_t *data) {
+  explicit ImuDataPacket(const std::uint8_t *data) {
     from_data(data);
   }
 
-  void from_data(std::uint8_t *data) {
+  void from_data(const std::uint8_t *data) {
     flag = *data + 1;
     timestamp =
         *(data + 2) | *(data + 3) << 8 | *(data + 4) << 16 | *(data + 5) << 24;
@@ -0,0 +1,189 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/device/convert_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+
+#include "mynteyed/util/log.h"
+
+#define CONVERT_MIN_BAND_ROWS 64
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+int get_hardware_threads() {
+  int n = static_cast<int>(std::thread::hardware_concurrency());
+  return n > 0 ? n : 1;
+}
+
+}  // namespace
+
+struct ConvertEngine::Batch {
+  const band_func_t* func;
+  int rows;
+  int bands;
+
+  std::atomic<int> next;
+  int done;
+  std::exception_ptr error;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  Batch(const band_func_t* func, int rows, int bands)
+    : func(func), rows(rows), bands(bands), next(0), done(0) {}
+};
+
+ConvertEngine& ConvertEngine::Instance() {
+  static ConvertEngine engine;
+  return engine;
+}
+
+ConvertEngine::ConvertEngine()
+  : threads_(get_hardware_threads()),
+    min_band_rows_(CONVERT_MIN_BAND_ROWS),
+    generation_(0) {
+}
+
+ConvertEngine::~ConvertEngine() {
+  StopWorkers();
+}
+
+void ConvertEngine::SetThreads(int threads) {
+  StopWorkers();
+  std::lock_guard<std::mutex> _(mutex_);
+  threads_ = threads > 0 ? threads : get_hardware_threads();
+  DBG_LOGI("ConvertEngine threads: %d", threads_);
+}
+
+int ConvertEngine::GetThreads() const {
+  std::lock_guard<std::mutex> _(mutex_);
+  return threads_;
+}
+
+void ConvertEngine::SetMinBandRows(int rows) {
+  std::lock_guard<std::mutex> _(mutex_);
+  min_band_rows_ = rows > 0 ? rows : 1;
+}
+
+int ConvertEngine::GetMinBandRows() const {
+  std::lock_guard<std::mutex> _(mutex_);
+  return min_band_rows_;
+}
+
+int ConvertEngine::GetBandCount(int rows) const {
+  std::lock_guard<std::mutex> _(mutex_);
+  if (rows <= 0) return 0;
+  return std::max(1, std::min(threads_, rows / min_band_rows_));
+}
+
+void ConvertEngine::ForEachBand(int rows, const band_func_t& func) {
+  int bands = GetBandCount(rows);
+  if (bands <= 0) return;
+  if (bands == 1) {
+    func(0, rows);
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>(&func, rows, bands);
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    if (workers_.empty()) {
+      StartWorkers(threads_ - 1);
+    }
+    // One entry per helper, the calling thread takes the first band
+    for (int i = 1; i < bands; ++i) {
+      batches_.push_back(batch);
+    }
+  }
+  condition_.notify_all();
+
+  RunBands(batch);
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->condition.wait(lock, [&batch] {
+    return batch->done == batch->bands;
+  });
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+void ConvertEngine::StartWorkers(int workers) {
+  // mutex_ is held
+  for (int i = 0; i < workers; ++i) {
+    workers_.push_back(std::thread(&ConvertEngine::Run, this, generation_));
+  }
+}
+
+void ConvertEngine::StopWorkers() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    ++generation_;
+    workers.swap(workers_);
+    // Callers run the bands left in their own thread
+    batches_.clear();
+  }
+  condition_.notify_all();
+  for (auto&& worker : workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+void ConvertEngine::Run(unsigned int generation) {
+  while (true) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this, generation] {
+        return generation_ != generation || !batches_.empty();
+      });
+      if (generation_ != generation) break;
+      batch = std::move(batches_.front());
+      batches_.pop_front();
+    }
+    RunBands(batch);
+  }
+}
+
+void ConvertEngine::RunBands(const std::shared_ptr<Batch>& batch) {
+  int i;
+  while ((i = batch->next++) < batch->bands) {
+    std::exception_ptr error;
+    try {
+      int row_begin = static_cast<int>(
+          static_cast<std::int64_t>(batch->rows) * i / batch->bands);
+      int row_end = static_cast<int>(
+          static_cast<std::int64_t>(batch->rows) * (i + 1) / batch->bands);
+      (*batch->func)(row_begin, row_end);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> _(batch->mutex);
+      if (error && !batch->error) batch->error = error;
+      if (++batch->done < batch->bands) continue;
+    }
+    batch->condition.notify_all();
+  }
+}
+
+MYNTEYE_END_NAMESPACE
@@ -0,0 +1,86 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_DEVICE_CONVERT_ENGINE_H_
+#define MYNTEYE_DEVICE_CONVERT_ENGINE_H_
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Runs image conversions as row bands on a shared pool of worker threads.
+ *
+ * The calling thread always takes part, so a conversion never waits on
+ * workers busy with another frame, and 1 thread means the old serial path.
+ */
+class ConvertEngine {
+ public:
+  using band_func_t = std::function<void(int row_begin, int row_end)>;
+
+  static ConvertEngine& Instance();
+
+  ~ConvertEngine();
+
+  // threads <= 0: use hardware concurrency
+  void SetThreads(int threads);
+  int GetThreads() const;
+
+  // The fewest rows a band has, keeps small images on one thread
+  void SetMinBandRows(int rows);
+  int GetMinBandRows() const;
+
+  // Splits rows [0, rows) into bands, runs func on each and waits for all.
+  void ForEachBand(int rows, const band_func_t& func);
+
+  // Bands ForEachBand() would use for the rows
+  int GetBandCount(int rows) const;
+
+ private:
+  struct Batch;
+
+  ConvertEngine();
+
+  void StartWorkers(int workers);
+  void StopWorkers();
+  void Run(unsigned int generation);
+
+  static void RunBands(const std::shared_ptr<Batch>& batch);
+
+  int threads_;
+  int min_band_rows_;
+
+  // Workers of an older generation exit
+  unsigned int generation_;
+  std::vector<std::thread> workers_;
+  std::deque<std::shared_ptr<Batch>> batches_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+
+  MYNTEYE_DISABLE_COPY(ConvertEngine)
+  MYNTEYE_DISABLE_MOVE(ConvertEngine)
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_DEVICE_CONVERT_ENGINE_H_
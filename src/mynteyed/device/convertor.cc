@@ -14,145 +14,190 @@
 #include "mynteyed/device/convertor.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYNTEYE_CONVERTOR_X86
+#endif
+#endif
+
+#ifdef MYNTEYE_CONVERTOR_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MYNTEYE_TARGET_AVX2
+#else
+#define MYNTEYE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
 
+#include "mynteyed/device/convert_engine.h"
+#include "mynteyed/device/jpeg_decoder.h"
 #include "mynteyed/util/log.h"
 
 MYNTEYE_BEGIN_NAMESPACE
 
-#ifdef WITH_JPEG
-
-namespace {
-
-METHODDEF(void)
-my_error_exit(j_common_ptr cinfo) {
-  /* cinfo->err really points to a my_error_mgr struct, so coerce pointer */
-  my_error_ptr myerr = (my_error_ptr) cinfo->err;
-
-  /* Always display the message. */
-  /* We could postpone this until after returning, if we chose. */
-  (*cinfo->err->output_message) (cinfo);
-
-  /* Return control to the setjmp point */
-  longjmp(myerr->setjmp_buffer, 1);
+int MJPEG_TO_RGB_LIBJPEG(unsigned char* jpg, int nJpgSize,
+    unsigned char* rgb, unsigned int rgb_step) {
+  return MJPEG_TO_RGB(jpg, nJpgSize, rgb, rgb_step);
 }
 
-}  // namespace
-
-#endif
+int MJPEG_TO_RGB(unsigned char* jpg, int nJpgSize, unsigned char* rgb,
+    unsigned int rgb_step) {
+  return JpegDecoder::ThreadInstance().Decode(jpg, nJpgSize, rgb,
+      JpegDecoder::PIXEL_RGB, rgb_step) ? 0 : -1;
+}
 
-int MJPEG_TO_RGB_LIBJPEG(unsigned char* jpg, int nJpgSize,
-    unsigned char* rgb) {
-#ifdef WITH_JPEG
-  struct jpeg_decompress_struct cinfo;
-  struct my_error_mgr jerr;
+int MJPEG_TO_BGR(unsigned char* jpg, int nJpgSize, unsigned char* bgr,
+    unsigned int bgr_step) {
+  return JpegDecoder::ThreadInstance().Decode(jpg, nJpgSize, bgr,
+      JpegDecoder::PIXEL_BGR, bgr_step) ? 0 : -1;
+}
 
-  int rc;
-  int row_stride, width, height, pixel_size;
+int MJPEG_TO_GRAY(unsigned char* jpg, int nJpgSize, unsigned char* gray,
+    unsigned int gray_step) {
+  return JpegDecoder::ThreadInstance().Decode(jpg, nJpgSize, gray,
+      JpegDecoder::PIXEL_GRAY, gray_step) ? 0 : -1;
+}
 
-  cinfo.err = jpeg_std_error(&jerr.pub);
-  jerr.pub.error_exit = my_error_exit;
+namespace {
 
-  if (setjmp(jerr.setjmp_buffer)) {
-    jpeg_destroy_decompress(&cinfo);
-    return 0;
-  }
+int mjpeg_to_half(unsigned char* jpg, int nJpgSize, unsigned char* half,
+    const JpegDecoder::Pixel& pixel, unsigned int width, unsigned int height,
+    bool right, unsigned int half_step) {
+  return JpegDecoder::ThreadInstance().DecodeCrop(jpg, nJpgSize, half, pixel,
+      right ? width / 2 : 0, width / 2, width, height, half_step) ? 0 : -1;
+}
 
-  jpeg_create_decompress(&cinfo);
-  jpeg_mem_src(&cinfo, jpg, nJpgSize);
+}  // namespace
 
-  rc = jpeg_read_header(&cinfo, TRUE);
+int MJPEG_TO_RGB_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step) {
+  return mjpeg_to_half(jpg, nJpgSize, left, JpegDecoder::PIXEL_RGB, width,
+      height, false, left_step);
+}
 
-  if (rc != 1) {
-    LOGE("Error: File does not seem to be a normal JPEG !!");
-  }
+int MJPEG_TO_RGB_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step) {
+  return mjpeg_to_half(jpg, nJpgSize, right, JpegDecoder::PIXEL_RGB, width,
+      height, true, right_step);
+}
 
-  jpeg_start_decompress(&cinfo);
+int MJPEG_TO_BGR_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step) {
+  return mjpeg_to_half(jpg, nJpgSize, left, JpegDecoder::PIXEL_BGR, width,
+      height, false, left_step);
+}
 
-  width = cinfo.output_width;
-  height = cinfo.output_height;
-  pixel_size = cinfo.output_components;
+int MJPEG_TO_BGR_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step) {
+  return mjpeg_to_half(jpg, nJpgSize, right, JpegDecoder::PIXEL_BGR, width,
+      height, true, right_step);
+}
 
-  row_stride = width * pixel_size;
+int MJPEG_TO_GRAY_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step) {
+  return mjpeg_to_half(jpg, nJpgSize, left, JpegDecoder::PIXEL_GRAY, width,
+      height, false, left_step);
+}
 
-  while (cinfo.output_scanline < cinfo.output_height) {
-    unsigned char *buffer_array[1];
-    // buffer_array[0] = rgb + (width * height * 3) -
-    //     (cinfo.output_scanline) * row_stride;
-    buffer_array[0] = rgb + (cinfo.output_scanline) * row_stride;
+int MJPEG_TO_GRAY_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step) {
+  return mjpeg_to_half(jpg, nJpgSize, right, JpegDecoder::PIXEL_GRAY, width,
+      height, true, right_step);
+}
 
-    jpeg_read_scanlines(&cinfo, buffer_array, 1);
-  }
+namespace {
 
-  jpeg_finish_decompress(&cinfo);
-  jpeg_destroy_decompress(&cinfo);
+// Copies or swizzles rows of width pixels, in row bands.
+void rgb_to_rows(unsigned char* src, unsigned char* dst, unsigned int width,
+    unsigned int height, bool swap, unsigned int bpp, unsigned int src_step,
+    unsigned int dst_step) {
+  unsigned int row = width * bpp;
+  if (src_step == 0) src_step = row;
+  if (dst_step == 0) dst_step = row;
+  ConvertEngine::Instance().ForEachBand(height,
+      [=](int row_begin, int row_end) {
+    for (int r = row_begin; r < row_end; ++r) {
+      unsigned char* s = src + static_cast<std::size_t>(r) * src_step;
+      unsigned char* d = dst + static_cast<std::size_t>(r) * dst_step;
+      if (!swap) {
+        std::copy(s, s + row, d);
+        continue;
+      }
+      for (unsigned int c = 0; c < width; ++c) {
+        *(d + c*3) = *(s + c*3 + 2);
+        *(d + c*3 + 1) = *(s + c*3 + 1);
+        *(d + c*3 + 2) = *(s + c*3);
+      }
+    }
+  });
+}
 
-  UNUSED(height);
-  return 0;
-#else
-  throw new std::runtime_error(
-      "Can't convert MJPG to RGB, as libjpeg not found.");
-#endif
+// Copies or swizzles one half of side-by-side rows.
+void rgb_to_half(unsigned char* rgb, unsigned char* half, unsigned int width,
+    unsigned int height, bool right, bool swap, unsigned int bpp,
+    unsigned int rgb_step, unsigned int half_step) {
+  if (rgb_step == 0) rgb_step = width * bpp;
+  if (right) rgb += width / 2 * bpp;
+  rgb_to_rows(rgb, half, width / 2, height, swap, bpp, rgb_step, half_step);
 }
 
+}  // namespace
+
 int RGB_TO_RGB_LEFT(unsigned char* rgb, unsigned char* left,
-    unsigned int width, unsigned int height) {
-  unsigned int row = width * 3;
-  unsigned int row_l = row / 2;
-
-  for (unsigned int r = 0; r < height; ++r) {
-    std::copy(rgb, rgb + row_l, left);
-    rgb += row;
-    left += row_l;
-  }
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int left_step) {
+  rgb_to_half(rgb, left, width, height, false, false, 3, rgb_step, left_step);
   return 0;
 }
 
 int RGB_TO_RGB_RIGHT(unsigned char* rgb, unsigned char* right,
-    unsigned int width, unsigned int height) {
-  unsigned int row = width * 3;
-  unsigned int row_r = row / 2;
-
-  rgb += row_r;
-  for (unsigned int r = 0; r < height; ++r) {
-    std::copy(rgb, rgb + row_r, right);
-    rgb += row;
-    right += row_r;
-  }
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int right_step) {
+  rgb_to_half(rgb, right, width, height, true, false, 3, rgb_step,
+      right_step);
   return 0;
 }
 
 int RGB_TO_BGR_LEFT(unsigned char* rgb, unsigned char* left,
-    unsigned int width, unsigned int height) {
-  unsigned int row = width * 3;
-  unsigned int row_l = row / 2;
-
-  for (unsigned int r = 0; r < height; ++r) {
-    for (unsigned int c = 0; c < width / 2; ++c) {
-      *(left + c*3) = *(rgb + c*3 + 2);
-      *(left + c*3 + 1) = *(rgb + c*3 + 1);
-      *(left + c*3 + 2) = *(rgb + c*3);
-    }
-    rgb += row;
-    left += row_l;
-  }
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int left_step) {
+  rgb_to_half(rgb, left, width, height, false, true, 3, rgb_step, left_step);
   return 0;
 }
 
 int RGB_TO_BGR_RIGHT(unsigned char* rgb, unsigned char* right,
-    unsigned int width, unsigned int height) {
-  unsigned int row = width * 3;
-  unsigned int row_r = row / 2;
-
-  rgb += row_r;
-  for (unsigned int r = 0; r < height; ++r) {
-    for (unsigned int c = 0; c < width / 2; ++c) {
-      *(right + c*3) = *(rgb + c*3 + 2);
-      *(right + c*3 + 1) = *(rgb + c*3 + 1);
-      *(right + c*3 + 2) = *(rgb + c*3);
-    }
-    rgb += row;
-    right += row_r;
-  }
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int right_step) {
+  rgb_to_half(rgb, right, width, height, true, true, 3, rgb_step,
+      right_step);
+  return 0;
+}
+
+int GRAY_TO_GRAY_LEFT(unsigned char* gray, unsigned char* left,
+    unsigned int width, unsigned int height, unsigned int gray_step,
+    unsigned int left_step) {
+  rgb_to_half(gray, left, width, height, false, false, 1, gray_step,
+      left_step);
+  return 0;
+}
+
+int GRAY_TO_GRAY_RIGHT(unsigned char* gray, unsigned char* right,
+    unsigned int width, unsigned int height, unsigned int gray_step,
+    unsigned int right_step) {
+  rgb_to_half(gray, right, width, height, true, false, 1, gray_step,
+      right_step);
   return 0;
 }
 
@@ -182,314 +227,676 @@ int yuv_to_rgb_pixel(int y, int u, int v) {
   return pixel32;
 }
 
-}  // namespace
+// Converts `pairs` YUYV macro pixels (4 bytes, 2 pixels each) of one row into
+// packed 24-bit RGB, or BGR if `bgr`.
+typedef void (*yuyv_row_func)(const unsigned char* yuv, unsigned char* out,
+    unsigned int pairs, bool bgr);
+
+void yuyv_row_c(const unsigned char* yuv, unsigned char* out,
+    unsigned int pairs, bool bgr) {
+  int ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+  for (unsigned int c = 0; c < pairs; ++c) {
+    int y0 = yuv[0], u = yuv[1], y1 = yuv[2], v = yuv[3];
+
+    unsigned int pixel32 = yuv_to_rgb_pixel(y0, u, v);
+    out[ri] = (pixel32 & 0x000000ff);
+    out[1]  = (pixel32 & 0x0000ff00) >> 8;
+    out[bi] = (pixel32 & 0x00ff0000) >> 16;
+
+    pixel32 = yuv_to_rgb_pixel(y1, u, v);
+    out[3 + ri] = (pixel32 & 0x000000ff);
+    out[3 + 1]  = (pixel32 & 0x0000ff00) >> 8;
+    out[3 + bi] = (pixel32 & 0x00ff0000) >> 16;
+
+    yuv += 4;
+    out += 6;
+  }
+}
 
-int YUYV_TO_RGB(unsigned char* yuv, unsigned char* rgb, unsigned int width,
-    unsigned int height) {
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < height; ++r) {
-    for (unsigned int c = 0; c < width / 2; ++c) {
-      in = (r * width * 2) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
+// SIMD kernels
+//
+// yuv_to_rgb_pixel() truncates `y + k * (c - 128)` computed in double. As y is
+// an integer and negative sums clamp to 0 anyway, that equals
+// `y + floor(k * (c - 128))`, and evaluating the chroma term in single
+// precision gives the same floor for every (y, u, v): it was checked
+// exhaustively over all 2^24 inputs. So the kernels below are bit-exact with
+// the scalar path. Do not build this file with -ffast-math or FMA contraction.
+
+#if defined(MYNTEYE_CONVERTOR_X86)
+
+#define YUYV_KR  1.370705f
+#define YUYV_KGV 0.698001f
+#define YUYV_KGU 0.337633f
+#define YUYV_KB  1.732446f
+
+// floor() for SSE2, which has only truncating conversions.
+inline __m128i floor_ps_epi32(__m128 x) {
+  __m128i t = _mm_cvttps_epi32(x);
+  __m128 gt = _mm_cmpgt_ps(_mm_cvtepi32_ps(t), x);
+  return _mm_add_epi32(t, _mm_castps_si128(gt));
+}
+
+// y + chroma term, clamped to [0, 255] and scaled by 220/256.
+// `c32` holds one term per macro pixel, which is duplicated to both pixels.
+inline __m128i yuyv_channel_sse2(__m128i y, __m128i c32) {
+  __m128i c16 = _mm_or_si128(_mm_and_si128(c32, _mm_set1_epi32(0xffff)),
+      _mm_slli_epi32(c32, 16));
+  __m128i x = _mm_add_epi16(y, c16);
+  x = _mm_min_epi16(_mm_max_epi16(x, _mm_setzero_si128()),
+      _mm_set1_epi16(255));
+  return _mm_srli_epi16(_mm_mullo_epi16(x, _mm_set1_epi16(220)), 8);
+}
+
+// 8 pixels from 16 bytes of YUYV, as 16-bit r, g, b.
+inline void yuyv_8_sse2(const unsigned char* yuv,
+    __m128i* r, __m128i* g, __m128i* b) {
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuv));
+  __m128i y = _mm_and_si128(a, _mm_set1_epi16(0x00ff));
+  __m128i uv = _mm_sub_epi16(_mm_srli_epi16(a, 8), _mm_set1_epi16(128));
+  __m128 du = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(uv, 16), 16));
+  __m128 dv = _mm_cvtepi32_ps(_mm_srai_epi32(uv, 16));
+
+  __m128 gs = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(YUYV_KGV), dv),
+      _mm_mul_ps(_mm_set1_ps(YUYV_KGU), du));
+  *r = yuyv_channel_sse2(y,
+      floor_ps_epi32(_mm_mul_ps(_mm_set1_ps(YUYV_KR), dv)));
+  *g = yuyv_channel_sse2(y,
+      floor_ps_epi32(_mm_sub_ps(_mm_setzero_ps(), gs)));
+  *b = yuyv_channel_sse2(y,
+      floor_ps_epi32(_mm_mul_ps(_mm_set1_ps(YUYV_KB), du)));
+}
+
+void yuyv_row_sse2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pairs, bool bgr) {
+  alignas(16) unsigned char c0[16], c1[16], c2[16];
+  unsigned int n = pairs / 8;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m128i r0, g0, b0, r1, g1, b1;
+    yuyv_8_sse2(yuv, &r0, &g0, &b0);
+    yuyv_8_sse2(yuv + 16, &r1, &g1, &b1);
+    __m128i r = _mm_packus_epi16(r0, r1);
+    __m128i g = _mm_packus_epi16(g0, g1);
+    __m128i b = _mm_packus_epi16(b0, b1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(c0), bgr ? b : r);
+    _mm_store_si128(reinterpret_cast<__m128i*>(c1), g);
+    _mm_store_si128(reinterpret_cast<__m128i*>(c2), bgr ? r : b);
+    for (int k = 0; k < 16; ++k) {
+      out[k*3] = c0[k];
+      out[k*3 + 1] = c1[k];
+      out[k*3 + 2] = c2[k];
     }
+    yuv += 32;
+    out += 48;
   }
+  yuyv_row_c(yuv, out, pairs - n * 8, bgr);
+}
 
-  return 0;
+MYNTEYE_TARGET_AVX2
+inline __m256i yuyv_channel_avx2(__m256i y, __m256 c) {
+  __m256i c32 = _mm256_cvttps_epi32(_mm256_floor_ps(c));
+  __m256i c16 = _mm256_or_si256(
+      _mm256_and_si256(c32, _mm256_set1_epi32(0xffff)),
+      _mm256_slli_epi32(c32, 16));
+  __m256i x = _mm256_add_epi16(y, c16);
+  x = _mm256_min_epi16(_mm256_max_epi16(x, _mm256_setzero_si256()),
+      _mm256_set1_epi16(255));
+  x = _mm256_srli_epi16(_mm256_mullo_epi16(x, _mm256_set1_epi16(220)), 8);
+  // 16 words to 16 bytes in order: packus works per 128-bit lane
+  x = _mm256_packus_epi16(x, x);
+  return _mm256_permute4x64_epi64(x, 0x08);
 }
 
-int YUYV_TO_RGB_LEFT(unsigned char* yuv, unsigned char* rgb,
-    unsigned int width, unsigned int height) {
-  unsigned int w = width / 2;
-  unsigned int h = height;
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < h; ++r) {
-    for (unsigned int c = 0; c < w / 2; ++c) {
-      in = (r * w * 4) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
-    }
+void yuyv_row_avx2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pairs, bool bgr) MYNTEYE_TARGET_AVX2;
+
+void yuyv_row_avx2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pairs, bool bgr) {
+  // pshufb masks spreading 16 planar bytes into 48 interleaved ones
+  const __m128i m00 = _mm_setr_epi8(
+      0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+  const __m128i m01 = _mm_setr_epi8(
+      -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+  const __m128i m02 = _mm_setr_epi8(
+      -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+  const __m128i m10 = _mm_setr_epi8(
+      -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+  const __m128i m11 = _mm_setr_epi8(
+      5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+  const __m128i m12 = _mm_setr_epi8(
+      -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+  const __m128i m20 = _mm_setr_epi8(
+      -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+  const __m128i m21 = _mm_setr_epi8(
+      -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+  const __m128i m22 = _mm_setr_epi8(
+      10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+  unsigned int n = pairs / 8;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(yuv));
+    __m256i y = _mm256_and_si256(a, _mm256_set1_epi16(0x00ff));
+    __m256i uv = _mm256_sub_epi16(_mm256_srli_epi16(a, 8),
+        _mm256_set1_epi16(128));
+    __m256 du = _mm256_cvtepi32_ps(
+        _mm256_srai_epi32(_mm256_slli_epi32(uv, 16), 16));
+    __m256 dv = _mm256_cvtepi32_ps(_mm256_srai_epi32(uv, 16));
+
+    __m256 gs = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(YUYV_KGV), dv),
+        _mm256_mul_ps(_mm256_set1_ps(YUYV_KGU), du));
+    __m128i r = _mm256_castsi256_si128(yuyv_channel_avx2(y,
+        _mm256_mul_ps(_mm256_set1_ps(YUYV_KR), dv)));
+    __m128i g = _mm256_castsi256_si128(yuyv_channel_avx2(y,
+        _mm256_sub_ps(_mm256_setzero_ps(), gs)));
+    __m128i b = _mm256_castsi256_si128(yuyv_channel_avx2(y,
+        _mm256_mul_ps(_mm256_set1_ps(YUYV_KB), du)));
+
+    __m128i c0 = bgr ? b : r;
+    __m128i c2 = bgr ? r : b;
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    _mm_storeu_si128(dst, _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(g, m01)),
+        _mm_shuffle_epi8(c2, m02)));
+    _mm_storeu_si128(dst + 1, _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, m10), _mm_shuffle_epi8(g, m11)),
+        _mm_shuffle_epi8(c2, m12)));
+    _mm_storeu_si128(dst + 2, _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, m20), _mm_shuffle_epi8(g, m21)),
+        _mm_shuffle_epi8(c2, m22)));
+    yuv += 32;
+    out += 48;
   }
+  yuyv_row_c(yuv, out, pairs - n * 8, bgr);
+}
 
-  return 0;
+bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return false;
+  __cpuid(info, 1);
+  // OSXSAVE, and the OS saves the YMM state
+  if ((info[2] & (1 << 27)) == 0) return false;
+  if ((_xgetbv(0) & 0x6) != 0x6) return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
 }
 
-int YUYV_TO_RGB_RIGHT(unsigned char* yuv, unsigned char* rgb,
-    unsigned int width, unsigned int height) {
-  unsigned int w = width / 2;
-  unsigned int h = height;
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < h; ++r) {
-    for (unsigned int c = 0; c < w / 2; ++c) {
-      in = (width + r * w * 4) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      rgb[out++] = pixel_24[0];
-      rgb[out++] = pixel_24[1];
-      rgb[out++] = pixel_24[2];
-    }
+#endif  // MYNTEYE_CONVERTOR_X86
+
+yuyv_row_func select_yuyv_row_func() {
+#if defined(MYNTEYE_CONVERTOR_X86)
+  if (cpu_has_avx2()) {
+    DBG_LOGI("YUYV convertor: avx2");
+    return yuyv_row_avx2;
   }
+  DBG_LOGI("YUYV convertor: sse2");
+  return yuyv_row_sse2;
+#else
+  return yuyv_row_c;
+#endif
+}
 
-  return 0;
+yuyv_row_func& yuyv_row_kernel() {
+  static yuyv_row_func kernel = select_yuyv_row_func();
+  return kernel;
 }
 
-int YUYV_TO_BGR(unsigned char* yuv, unsigned char* bgr, unsigned int width,
-    unsigned int height) {
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < height; ++r) {
-    for (unsigned int c = 0; c < width / 2; ++c) {
-      in = (r * width * 2) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
+void yuyv_to_c3(const unsigned char* yuv, unsigned int yuv_step,
+    unsigned char* out, unsigned int out_step, unsigned int pairs,
+    unsigned int rows, bool bgr) {
+  const yuyv_row_func row_func = yuyv_row_kernel();
+  if (out_step == 0) out_step = pairs * 6;
+  ConvertEngine::Instance().ForEachBand(rows,
+      [=](int row_begin, int row_end) {
+    for (int r = row_begin; r < row_end; ++r) {
+      std::size_t i = r;
+      row_func(yuv + i * yuv_step, out + i * out_step, pairs, bgr);
     }
+  });
+}
+
+// Converts `pixels` YUYV pixels of one row into 8-bit gray, the Y as is.
+typedef void (*yuyv_y_row_func)(const unsigned char* yuv, unsigned char* out,
+    unsigned int pixels);
+
+void yuyv_y_row_c(const unsigned char* yuv, unsigned char* out,
+    unsigned int pixels) {
+  for (unsigned int i = 0; i < pixels; ++i) {
+    out[i] = yuv[i * 2];
+  }
+}
+
+#if defined(MYNTEYE_CONVERTOR_X86)
+
+void yuyv_y_row_sse2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pixels) {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  unsigned int n = pixels / 16;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuv));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yuv + 16));
+    __m128i y = _mm_packus_epi16(_mm_and_si128(a, mask),
+        _mm_and_si128(b, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), y);
+    yuv += 32;
+    out += 16;
   }
+  yuyv_y_row_c(yuv, out, pixels - n * 16);
+}
+
+void yuyv_y_row_avx2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pixels) MYNTEYE_TARGET_AVX2;
+
+void yuyv_y_row_avx2(const unsigned char* yuv, unsigned char* out,
+    unsigned int pixels) {
+  const __m256i mask = _mm256_set1_epi16(0x00ff);
+  unsigned int n = pixels / 32;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(yuv));
+    __m256i b = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(yuv + 32));
+    __m256i y = _mm256_packus_epi16(_mm256_and_si256(a, mask),
+        _mm256_and_si256(b, mask));
+    // packus works per 128-bit lane
+    y = _mm256_permute4x64_epi64(y, 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), y);
+    yuv += 64;
+    out += 32;
+  }
+  yuyv_y_row_sse2(yuv, out, pixels - n * 32);
+}
+
+#endif  // MYNTEYE_CONVERTOR_X86
+
+yuyv_y_row_func select_yuyv_y_row_func() {
+#if defined(MYNTEYE_CONVERTOR_X86)
+  if (cpu_has_avx2()) return yuyv_y_row_avx2;
+  return yuyv_y_row_sse2;
+#else
+  return yuyv_y_row_c;
+#endif
+}
+
+yuyv_y_row_func& yuyv_y_row_kernel() {
+  static yuyv_y_row_func kernel = select_yuyv_y_row_func();
+  return kernel;
+}
+
+void yuyv_to_c1(const unsigned char* yuv, unsigned int yuv_step,
+    unsigned char* out, unsigned int out_step, unsigned int pixels,
+    unsigned int rows) {
+  const yuyv_y_row_func row_func = yuyv_y_row_kernel();
+  if (out_step == 0) out_step = pixels;
+  ConvertEngine::Instance().ForEachBand(rows,
+      [=](int row_begin, int row_end) {
+    for (int r = row_begin; r < row_end; ++r) {
+      std::size_t i = r;
+      row_func(yuv + i * yuv_step, out + i * out_step, pixels);
+    }
+  });
+}
+
+}  // namespace
 
+int YUYV_TO_RGB(unsigned char* yuv, unsigned char* rgb, unsigned int width,
+    unsigned int height, unsigned int rgb_step, unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv, yuv_step, rgb, rgb_step, width / 2, height, false);
+  return 0;
+}
+
+int YUYV_TO_RGB_LEFT(unsigned char* yuv, unsigned char* rgb,
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv, yuv_step, rgb, rgb_step, width / 4, height, false);
+  return 0;
+}
+
+int YUYV_TO_RGB_RIGHT(unsigned char* yuv, unsigned char* rgb,
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv + width, yuv_step, rgb, rgb_step, width / 4, height, false);
+  return 0;
+}
+
+int YUYV_TO_BGR(unsigned char* yuv, unsigned char* bgr, unsigned int width,
+    unsigned int height, unsigned int bgr_step, unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv, yuv_step, bgr, bgr_step, width / 2, height, true);
   return 0;
 }
 
 int YUYV_TO_BGR_LEFT(unsigned char* yuv, unsigned char* bgr,
-    unsigned int width, unsigned int height) {
-  unsigned int w = width / 2;
-  unsigned int h = height;
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < h; ++r) {
-    for (unsigned int c = 0; c < w / 2; ++c) {
-      in = (r * w * 4) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
+    unsigned int width, unsigned int height, unsigned int bgr_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv, yuv_step, bgr, bgr_step, width / 4, height, true);
+  return 0;
+}
+
+int YUYV_TO_BGR_RIGHT(unsigned char* yuv, unsigned char* bgr,
+    unsigned int width, unsigned int height, unsigned int bgr_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c3(yuv + width, yuv_step, bgr, bgr_step, width / 4, height, true);
+  return 0;
+}
+
+int YUYV_TO_GRAY(unsigned char* yuv, unsigned char* gray, unsigned int width,
+    unsigned int height, unsigned int gray_step, unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c1(yuv, yuv_step, gray, gray_step, width, height);
+  return 0;
+}
+
+int YUYV_TO_GRAY_LEFT(unsigned char* yuv, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int gray_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c1(yuv, yuv_step, gray, gray_step, width / 2, height);
+  return 0;
+}
+
+int YUYV_TO_GRAY_RIGHT(unsigned char* yuv, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int gray_step,
+    unsigned int yuv_step) {
+  if (yuv_step == 0) yuv_step = width * 2;
+  yuyv_to_c1(yuv + width, yuv_step, gray, gray_step, width / 2, height);
+  return 0;
+}
+
+bool SET_YUYV_KERNELS(const YuyvKernels& kernels) {
+  switch (kernels) {
+    case YuyvKernels::C:
+      yuyv_row_kernel() = yuyv_row_c;
+      yuyv_y_row_kernel() = yuyv_y_row_c;
+      return true;
+#if defined(MYNTEYE_CONVERTOR_X86)
+    case YuyvKernels::SSE2:
+      yuyv_row_kernel() = yuyv_row_sse2;
+      yuyv_y_row_kernel() = yuyv_y_row_sse2;
+      return true;
+    case YuyvKernels::AVX2:
+      if (!cpu_has_avx2()) return false;
+      yuyv_row_kernel() = yuyv_row_avx2;
+      yuyv_y_row_kernel() = yuyv_y_row_avx2;
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+namespace {
+
+// Depth to gray
+//
+// gray = 255 * x / dist, x = clamp(depth, low, high) - low, dist = high - low.
+// The division is a multiply by the float reciprocal, then corrected by one
+// if off, so equals the integer division for every x: 255 * x < 2^24, so
+// q * dist and n below fit in 32 bits.
+
+typedef void (*depth_minmax_row_func)(const std::uint16_t* depth,
+    unsigned int width, std::uint16_t* min, std::uint16_t* max);
+typedef void (*depth_gray_row_func)(const std::uint16_t* depth,
+    unsigned char* gray, unsigned int width, std::uint16_t low,
+    std::uint16_t high, float r);
+
+void depth_minmax_row_c(const std::uint16_t* depth, unsigned int width,
+    std::uint16_t* min, std::uint16_t* max) {
+  std::uint16_t lo = *min, hi = *max;
+  for (unsigned int i = 0; i < width; ++i) {
+    if (depth[i] < lo) lo = depth[i];
+    if (depth[i] > hi) hi = depth[i];
+  }
+  *min = lo;
+  *max = hi;
+}
+
+void depth_gray_row_c(const std::uint16_t* depth, unsigned char* gray,
+    unsigned int width, std::uint16_t low, std::uint16_t high, float r) {
+  unsigned int dist = high - low;
+  for (unsigned int i = 0; i < width; ++i) {
+    unsigned int x = std::min(std::max(depth[i], low), high) - low;
+    unsigned int n = x * 255;
+    unsigned int q = static_cast<unsigned int>(x * r);
+    if (q * dist > n) {
+      --q;
+    } else if ((q + 1) * dist <= n) {
+      ++q;
     }
+    gray[i] = static_cast<unsigned char>(q);
   }
+}
 
-  return 0;
+#if defined(MYNTEYE_CONVERTOR_X86)
+
+void depth_minmax_row_avx2(const std::uint16_t* depth, unsigned int width,
+    std::uint16_t* min, std::uint16_t* max) MYNTEYE_TARGET_AVX2;
+
+void depth_minmax_row_avx2(const std::uint16_t* depth, unsigned int width,
+    std::uint16_t* min, std::uint16_t* max) {
+  __m256i lo = _mm256_set1_epi16(static_cast<short>(*min));  // NOLINT
+  __m256i hi = _mm256_set1_epi16(static_cast<short>(*max));  // NOLINT
+  unsigned int n = width / 16;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m256i d = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(depth + i * 16));
+    lo = _mm256_min_epu16(lo, d);
+    hi = _mm256_max_epu16(hi, d);
+  }
+  alignas(32) std::uint16_t los[16], his[16];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(los), lo);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(his), hi);
+  for (int k = 0; k < 16; ++k) {
+    if (los[k] < *min) *min = los[k];
+    if (his[k] > *max) *max = his[k];
+  }
+  depth_minmax_row_c(depth + n * 16, width - n * 16, min, max);
 }
 
-int YUYV_TO_BGR_RIGHT(unsigned char* yuv, unsigned char* bgr,
-    unsigned int width, unsigned int height) {
-  unsigned int w = width / 2;
-  unsigned int h = height;
-  unsigned int in, out = 0;
-  unsigned int pixel_16;
-  unsigned char pixel_24[3];
-  unsigned int pixel32;
-  int y0, u, y1, v;
-
-  for (unsigned int r = 0; r < h; ++r) {
-    for (unsigned int c = 0; c < w / 2; ++c) {
-      in = (width + r * w * 4) + (c * 4);
-
-      pixel_16 =
-      yuv[in + 3] << 24 |
-      yuv[in + 2] << 16 |
-      yuv[in + 1] <<  8 |
-      yuv[in + 0];
-
-      y0 = (pixel_16 & 0x000000ff);
-      u  = (pixel_16 & 0x0000ff00) >>  8;
-      y1 = (pixel_16 & 0x00ff0000) >> 16;
-      v  = (pixel_16 & 0xff000000) >> 24;
-
-      pixel32 = yuv_to_rgb_pixel(y0, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
-
-      pixel32 = yuv_to_rgb_pixel(y1, u, v);
-
-      pixel_24[0] = (pixel32 & 0x000000ff);
-      pixel_24[1] = (pixel32 & 0x0000ff00) >> 8;
-      pixel_24[2] = (pixel32 & 0x00ff0000) >> 16;
-      bgr[out++] = pixel_24[2];
-      bgr[out++] = pixel_24[1];
-      bgr[out++] = pixel_24[0];
+// 8 x as 32-bit to gray as 32-bit
+MYNTEYE_TARGET_AVX2
+inline __m256i depth_gray_avx2(__m256i x, __m256 r, __m256i dist) {
+  __m256i n = _mm256_mullo_epi32(x, _mm256_set1_epi32(255));
+  __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(x), r));
+  __m256i qd = _mm256_mullo_epi32(q, dist);
+  // -1 if q * dist > n, +1 if (q + 1) * dist <= n
+  __m256i over = _mm256_cmpgt_epi32(qd, n);
+  __m256i under = _mm256_andnot_si256(
+      _mm256_cmpgt_epi32(_mm256_add_epi32(qd, dist), n),
+      _mm256_set1_epi32(1));
+  return _mm256_add_epi32(_mm256_add_epi32(q, over), under);
+}
+
+void depth_gray_row_avx2(const std::uint16_t* depth, unsigned char* gray,
+    unsigned int width, std::uint16_t low, std::uint16_t high, float r)
+    MYNTEYE_TARGET_AVX2;
+
+void depth_gray_row_avx2(const std::uint16_t* depth, unsigned char* gray,
+    unsigned int width, std::uint16_t low, std::uint16_t high, float r) {
+  const __m256i vlow = _mm256_set1_epi16(static_cast<short>(low));  // NOLINT
+  const __m256i vhigh = _mm256_set1_epi16(static_cast<short>(high));  // NOLINT
+  const __m256i vdist = _mm256_set1_epi32(high - low);
+  const __m256 vr = _mm256_set1_ps(r);
+  unsigned int n = width / 16;
+  for (unsigned int i = 0; i < n; ++i) {
+    __m256i d = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(depth + i * 16));
+    d = _mm256_sub_epi16(
+        _mm256_min_epu16(_mm256_max_epu16(d, vlow), vhigh), vlow);
+    __m256i q0 = depth_gray_avx2(
+        _mm256_cvtepu16_epi32(_mm256_castsi256_si128(d)), vr, vdist);
+    __m256i q1 = depth_gray_avx2(
+        _mm256_cvtepu16_epi32(_mm256_extracti128_si256(d, 1)), vr, vdist);
+    // packus works per 128-bit lane
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), 0xd8);
+    __m128i b = _mm_packus_epi16(_mm256_castsi256_si128(w),
+        _mm256_extracti128_si256(w, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i * 16), b);
+  }
+  depth_gray_row_c(depth + n * 16, gray + n * 16, width - n * 16, low, high,
+      r);
+}
+
+#endif  // MYNTEYE_CONVERTOR_X86
+
+depth_minmax_row_func select_depth_minmax_row_func() {
+#if defined(MYNTEYE_CONVERTOR_X86)
+  if (cpu_has_avx2()) return depth_minmax_row_avx2;
+#endif
+  return depth_minmax_row_c;
+}
+
+depth_gray_row_func select_depth_gray_row_func() {
+#if defined(MYNTEYE_CONVERTOR_X86)
+  if (cpu_has_avx2()) return depth_gray_row_avx2;
+#endif
+  return depth_gray_row_c;
+}
+
+depth_minmax_row_func& depth_minmax_row_kernel() {
+  static depth_minmax_row_func kernel = select_depth_minmax_row_func();
+  return kernel;
+}
+
+depth_gray_row_func& depth_gray_row_kernel() {
+  static depth_gray_row_func kernel = select_depth_gray_row_func();
+  return kernel;
+}
+
+void depth_to_gray(const unsigned char* depth, unsigned int depth_step,
+    unsigned char* gray, unsigned int gray_step, unsigned int width,
+    unsigned int height, std::uint16_t low, std::uint16_t high) {
+  const depth_gray_row_func row_func = depth_gray_row_kernel();
+  if (depth_step == 0) depth_step = width * 2;
+  if (gray_step == 0) gray_step = width;
+  if (high <= low) {
+    // Flat, or no range
+    for (unsigned int r = 0; r < height; ++r) {
+      std::fill(gray + r * gray_step, gray + r * gray_step + width, 0);
     }
+    return;
   }
+  float rcp = 255.f / (high - low);
+  ConvertEngine::Instance().ForEachBand(height,
+      [=](int row_begin, int row_end) {
+    for (int r = row_begin; r < row_end; ++r) {
+      std::size_t i = r;
+      row_func(reinterpret_cast<const std::uint16_t*>(depth + i * depth_step),
+          gray + i * gray_step, width, low, high, rcp);
+    }
+  });
+}
+
+}  // namespace
+
+int DEPTH_TO_GRAY(unsigned char* depth, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int depth_step,
+    unsigned int gray_step) {
+  const depth_minmax_row_func row_func = depth_minmax_row_kernel();
+  if (width == 0 || height == 0) return 0;
+  if (depth_step == 0) depth_step = width * 2;
+
+  // min & max of each band, then of all
+  std::uint16_t depth_min, depth_max;
+  depth_min = depth_max = *reinterpret_cast<std::uint16_t*>(depth);
+  std::mutex mutex;
+  ConvertEngine::Instance().ForEachBand(height,
+      [&](int row_begin, int row_end) {
+    std::uint16_t band_min = depth_min, band_max = depth_max;
+    for (int r = row_begin; r < row_end; ++r) {
+      std::size_t i = r;
+      row_func(reinterpret_cast<const std::uint16_t*>(depth + i * depth_step),
+          width, &band_min, &band_max);
+    }
+    std::lock_guard<std::mutex> _(mutex);
+    if (band_min < depth_min) depth_min = band_min;
+    if (band_max > depth_max) depth_max = band_max;
+  });
 
+  depth_to_gray(depth, depth_step, gray, gray_step, width, height, depth_min,
+      depth_max);
   return 0;
 }
 
-namespace {
+int DEPTH_TO_GRAY_RANGE(unsigned char* depth, unsigned char* gray,
+    unsigned int width, unsigned int height, std::uint16_t depth_near,
+    std::uint16_t depth_far, unsigned int depth_step,
+    unsigned int gray_step) {
+  depth_to_gray(depth, depth_step, gray, gray_step, width, height,
+      depth_near, depth_far);
+  return 0;
+}
 
-void reverse(unsigned char* rgb, unsigned int width, unsigned int height) {
-  unsigned char tmp;
-  for (unsigned int i = 0, n = width * height; i < n; i++) {
-    tmp = *rgb;         // tmp = r
-    *rgb = *(rgb + 2);  // r = b
-    *(rgb + 2) = tmp;   // b = tmp
-    rgb += 3;
+bool SET_DEPTH_KERNELS(const DepthKernels& kernels) {
+  switch (kernels) {
+    case DepthKernels::C:
+      depth_minmax_row_kernel() = depth_minmax_row_c;
+      depth_gray_row_kernel() = depth_gray_row_c;
+      return true;
+#if defined(MYNTEYE_CONVERTOR_X86)
+    case DepthKernels::AVX2:
+      if (!cpu_has_avx2()) return false;
+      depth_minmax_row_kernel() = depth_minmax_row_avx2;
+      depth_gray_row_kernel() = depth_gray_row_avx2;
+      return true;
+#endif
+    default:
+      return false;
   }
 }
 
+namespace {
+
+void reverse(unsigned char* rgb, unsigned int width, unsigned int height,
+    unsigned int step) {
+  if (step == 0) step = width * 3;
+  ConvertEngine::Instance().ForEachBand(height,
+      [rgb, width, step](int row_begin, int row_end) {
+    unsigned char tmp;
+    for (int r = row_begin; r < row_end; ++r) {
+      unsigned char* p = rgb + static_cast<std::size_t>(r) * step;
+      for (unsigned int i = 0; i < width; i++) {
+        tmp = *p;         // tmp = r
+        *p = *(p + 2);    // r = b
+        *(p + 2) = tmp;   // b = tmp
+        p += 3;
+      }
+    }
+  });
+}
+
 }  // namespace
 
+int RGB_TO_BGR_COPY(unsigned char* rgb, unsigned char* bgr,
+    unsigned int width, unsigned int height, unsigned int rgb_step,
+    unsigned int bgr_step) {
+  rgb_to_rows(rgb, bgr, width, height, true, 3, rgb_step, bgr_step);
+  return 0;
+}
+
+int BGR_TO_RGB_COPY(unsigned char* bgr, unsigned char* rgb,
+    unsigned int width, unsigned int height, unsigned int bgr_step,
+    unsigned int rgb_step) {
+  rgb_to_rows(bgr, rgb, width, height, true, 3, bgr_step, rgb_step);
+  return 0;
+}
+
 void RGB_TO_BGR(unsigned char* rgb,
-    unsigned int width, unsigned int height) {
-  reverse(rgb, width, height);
+    unsigned int width, unsigned int height, unsigned int step) {
+  reverse(rgb, width, height, step);
 }
 
 void BGR_TO_RGB(unsigned char* bgr,
-    unsigned int width, unsigned int height) {
-  reverse(bgr, width, height);
+    unsigned int width, unsigned int height, unsigned int step) {
+  reverse(bgr, width, height, step);
 }
 
 namespace {
@@ -503,17 +910,18 @@ void swap(unsigned char* a, unsigned char* b, unsigned char* tmp) {
 }  // namespace
 
 void FLIP_UP_DOWN_C3(unsigned char* rgb, unsigned int width,
-                     unsigned int height) {
+                     unsigned int height, unsigned int step) {
   if (height <= 1) return;
   width = width * 3;  // channel 3
+  if (step == 0) step = width;
   unsigned char* up;
   unsigned char* down;
   // h = 4, h/2 = 2: 0 1 2 3
   // h = 5, h/2 = 2: 0 1 2 3 4
   unsigned char tmp;
   for (unsigned int m = 0; m < height / 2; m++) {
-    up = rgb + m * width;
-    down = rgb + (height - 1 - m) * width;
+    up = rgb + m * step;
+    down = rgb + (height - 1 - m) * step;
     for (unsigned int n = 0; n < width; n++) {
       swap(up + n, down + n, &tmp);  // NOLINT
     }
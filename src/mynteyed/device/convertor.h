@@ -28,6 +28,8 @@ extern "C" {
 
 #endif
 
+#include <cstdint>
+
 #include "mynteyed/stubs/global.h"
 
 MYNTEYE_BEGIN_NAMESPACE
@@ -44,40 +46,141 @@ typedef struct my_error_mgr* my_error_ptr;
 #endif
 
 extern int MJPEG_TO_RGB_LIBJPEG(unsigned char* jpg, int nJpgSize,
-    unsigned char* rgb);
+    unsigned char* rgb, unsigned int rgb_step = 0);
+
+// The step arguments below are the bytes of a row, 0 means packed.
+
+// Decode with the reused decoder of the calling thread, 0 if succeeded
+extern int MJPEG_TO_RGB(unsigned char* jpg, int nJpgSize, unsigned char* rgb,
+    unsigned int rgb_step = 0);
+extern int MJPEG_TO_BGR(unsigned char* jpg, int nJpgSize, unsigned char* bgr,
+    unsigned int bgr_step = 0);
+// Decode the luminance only
+extern int MJPEG_TO_GRAY(unsigned char* jpg, int nJpgSize,
+    unsigned char* gray, unsigned int gray_step = 0);
+
+// Decode the left or right half of side-by-side frames only
+extern int MJPEG_TO_RGB_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step = 0);
+extern int MJPEG_TO_RGB_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step = 0);
+extern int MJPEG_TO_BGR_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step = 0);
+extern int MJPEG_TO_BGR_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step = 0);
+extern int MJPEG_TO_GRAY_LEFT(unsigned char* jpg, int nJpgSize,
+    unsigned char* left, unsigned int width, unsigned int height,
+    unsigned int left_step = 0);
+extern int MJPEG_TO_GRAY_RIGHT(unsigned char* jpg, int nJpgSize,
+    unsigned char* right, unsigned int width, unsigned int height,
+    unsigned int right_step = 0);
 
 extern int RGB_TO_RGB_LEFT(unsigned char* orig, unsigned char* left,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int left_step = 0);
 extern int RGB_TO_RGB_RIGHT(unsigned char* orig, unsigned char* right,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int right_step = 0);
 
 extern int RGB_TO_BGR_LEFT(unsigned char* orig, unsigned char* left,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int left_step = 0);
 extern int RGB_TO_BGR_RIGHT(unsigned char* orig, unsigned char* right,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int right_step = 0);
+
+extern int GRAY_TO_GRAY_LEFT(unsigned char* orig, unsigned char* left,
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int left_step = 0);
+extern int GRAY_TO_GRAY_RIGHT(unsigned char* orig, unsigned char* right,
+    unsigned int width, unsigned int height, unsigned int orig_step = 0,
+    unsigned int right_step = 0);
 
 extern int YUYV_TO_RGB(unsigned char* yuv, unsigned char* rgb,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int rgb_step = 0,
+    unsigned int yuv_step = 0);
 extern int YUYV_TO_RGB_LEFT(unsigned char* yuv, unsigned char* rgb,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int rgb_step = 0,
+    unsigned int yuv_step = 0);
 extern int YUYV_TO_RGB_RIGHT(unsigned char* yuv, unsigned char* rgb,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int rgb_step = 0,
+    unsigned int yuv_step = 0);
 
 extern int YUYV_TO_BGR(unsigned char* yuv, unsigned char* bgr,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int bgr_step = 0,
+    unsigned int yuv_step = 0);
 extern int YUYV_TO_BGR_LEFT(unsigned char* yuv, unsigned char* bgr,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int bgr_step = 0,
+    unsigned int yuv_step = 0);
 extern int YUYV_TO_BGR_RIGHT(unsigned char* yuv, unsigned char* bgr,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int bgr_step = 0,
+    unsigned int yuv_step = 0);
+
+// Extract the Y plane, without color conversion
+extern int YUYV_TO_GRAY(unsigned char* yuv, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int gray_step = 0,
+    unsigned int yuv_step = 0);
+extern int YUYV_TO_GRAY_LEFT(unsigned char* yuv, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int gray_step = 0,
+    unsigned int yuv_step = 0);
+extern int YUYV_TO_GRAY_RIGHT(unsigned char* yuv, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int gray_step = 0,
+    unsigned int yuv_step = 0);
+
+// Row kernels of the YUYV_TO_* above, the best the cpu supports by default
+enum class YuyvKernels : std::int32_t {
+  C = 0,
+  SSE2 = 1,
+  AVX2 = 2,
+};
+
+// Uses the kernels since now, e.g. to check them against C. Not while
+// converting. false if not supported on this cpu.
+extern bool SET_YUYV_KERNELS(const YuyvKernels& kernels);
+
+extern int RGB_TO_BGR_COPY(unsigned char* rgb, unsigned char* bgr,
+    unsigned int width, unsigned int height, unsigned int rgb_step = 0,
+    unsigned int bgr_step = 0);
+extern int BGR_TO_RGB_COPY(unsigned char* bgr, unsigned char* rgb,
+    unsigned int width, unsigned int height, unsigned int bgr_step = 0,
+    unsigned int rgb_step = 0);
+
+// Normalizes 16-bit depth to 8-bit gray, 255 * (depth - min) / (max - min)
+// of the min and max of the frame. All 0 if the frame is flat.
+extern int DEPTH_TO_GRAY(unsigned char* depth, unsigned char* gray,
+    unsigned int width, unsigned int height, unsigned int depth_step = 0,
+    unsigned int gray_step = 0);
+// Normalizes as DEPTH_TO_GRAY, but of the fixed range [near, far] in mm,
+// depth out of it clamped. Single pass, not to find the min and max.
+extern int DEPTH_TO_GRAY_RANGE(unsigned char* depth, unsigned char* gray,
+    unsigned int width, unsigned int height, std::uint16_t depth_near,
+    std::uint16_t depth_far, unsigned int depth_step = 0,
+    unsigned int gray_step = 0);
+
+// Row kernels of the DEPTH_TO_GRAY* above, the best the cpu supports by
+// default
+enum class DepthKernels : std::int32_t {
+  C = 0,
+  AVX2 = 1,
+};
+
+// Uses the kernels since now, e.g. to check them against C. Not while
+// converting. false if not supported on this cpu.
+extern bool SET_DEPTH_KERNELS(const DepthKernels& kernels);
 
+// In place
 extern void RGB_TO_BGR(unsigned char* rgb,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int step = 0);
 
 extern void BGR_TO_RGB(unsigned char* bgr,
-    unsigned int width, unsigned int height);
+    unsigned int width, unsigned int height, unsigned int step = 0);
 
 extern void FLIP_UP_DOWN_C3(unsigned char* rgb, unsigned int width,
-                            unsigned int height);
+                            unsigned int height, unsigned int step = 0);
 
 MYNTEYE_END_NAMESPACE
 
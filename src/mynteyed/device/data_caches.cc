@@ -14,86 +14,607 @@
 #include "mynteyed/device/data_caches.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <iostream>
-#include <iterator>
+#include <type_traits>
 
 #include "mynteyed/util/log.h"
 
 // #define CACHES_INFO_PRINT
 #define CACHES_EACH_MAX_SIZE 12
+// Upper limit of the capacity, slots of each size class
+#define CACHES_SLOTS_MAX 64
+// Upper limit of the size classes
+#define CACHES_CLASSES_MAX 64
 
 MYNTEYE_USE_NAMESPACE
 
-DataCaches::DataCaches() {
+namespace {
+
+void update_max(std::atomic<std::size_t>* value, std::size_t candidate) {
+  auto current = value->load(std::memory_order_relaxed);
+  while (current < candidate &&
+      !value->compare_exchange_weak(current, candidate,
+          std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+/**
+ * Bytes of the pooled buffers, may shared by pools.
+ */
+struct DataCaches::Budget {
+  std::atomic<size_t> max_bytes;
+  std::atomic<size_t> bytes;
+
+  Budget() : max_bytes(0), bytes(0) {}
+
+  bool Reserve(const size_t& n) {
+    auto max = max_bytes.load(std::memory_order_relaxed);
+    if (bytes.fetch_add(n, std::memory_order_relaxed) + n > max && max > 0) {
+      bytes.fetch_sub(n, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  void Release(const size_t& n) {
+    bytes.fetch_sub(n, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Buffers of one size.
+ *
+ * The free buffers are a lock-free stack of slot indexes, and the slots
+ * without buffer, trimmed, are another. The head packs a tag with the top
+ * index, the tag changes on every update, so a slot popped and pushed back
+ * in between could not fool the compare exchange (ABA).
+ *
+ * Each slot also stores the shared_ptr control block of its data, so a get
+ * allocates nothing. The slot is pushed back when the control block is freed,
+ * after the last reference dropped, and nothing touches it any more.
+ *
+ * The class counts a reference for the pool and each buffer in use, so it
+ * lives until the pool and all its buffers have gone.
+ */
+class DataCaches::SizeClass {
+ public:
+  SizeClass(const size_t& size, const std::shared_ptr<Budget>& budget)
+    : size_(size), proper_(false), budget_(budget),
+      free_head_(0), empty_head_(0),
+      next_(new std::atomic<std::uint32_t>[CACHES_SLOTS_MAX]),
+      slots_(new data_t*[CACHES_SLOTS_MAX]()),
+      blocks_(new block_t[CACHES_SLOTS_MAX]),
+      slots_used_(0), refs_(1), pooled_(0), reserved_(0),
+      in_use_peak_(0), window_peak_(0), overflows_(0), failures_(0),
+      waiters_(0) {
+    for (int i = 0; i < CACHES_SLOTS_MAX; i++) {
+      next_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ~SizeClass() {
+    // All released here, as the buffers in use own this
+    auto used = std::min<size_t>(slots_used_.load(), CACHES_SLOTS_MAX);
+    for (size_t i = 0; i < used; i++) {
+      if (slots_[i] == nullptr) continue;
+      delete slots_[i];
+      budget_->Release(size_);
+    }
+  }
+
+  // Drops the reference of the pool
+  void Unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
+
+  size_t size() const { return size_; }
+
+  bool proper() const { return proper_.load(std::memory_order_relaxed); }
+  void set_proper(bool proper) { proper_.store(proper); }
+
+  data_ptr_t Get(size_t capacity, const Policy& policy,
+      std::uint32_t block_timeout_ms, bool huge_pages) {
+    auto slot = Pop(&free_head_);
+    if (slot < 0) slot = Create(capacity, huge_pages);
+    if (slot < 0) {
+      switch (policy) {
+        case Policy::ALLOCATE:
+          if (overflows_.fetch_add(1) == 0) {
+            LOGW("Caches(%d) is full, allocate over the capacity %d or "
+                "the max bytes", size_, capacity);
+          }
+          CountIn();
+          return data_ptr_t(new data_t(size_, huge_pages),
+              OverflowDeleter{this});
+        case Policy::BLOCK:
+          slot = Wait(block_timeout_ms);
+          if (slot >= 0) break;
+          // fall through
+        case Policy::FAIL:
+        default:
+          if (failures_.fetch_add(1) == 0) {
+            LOGW("Caches(%d) is exhausted at the capacity %d or the max bytes",
+                size_, capacity);
+          }
+          return nullptr;
+      }
+    }
+#ifdef CACHES_INFO_PRINT
+    LOGI("Get cache: %d, slot: %d", size_, slot);
+#endif
+    CountIn();
+    return data_ptr_t(slots_[slot], SlotDeleter(),
+        SlotAllocator<data_t>(this, slot));
+  }
+
+  // Pools count buffers allocated and page faulted, kept from trimming
+  void Prewarm(size_t count, bool huge_pages) {
+    count = std::min<size_t>(count, CACHES_SLOTS_MAX);
+    update_max(&reserved_, count);
+    while (pooled_.load() < count) {
+      auto slot = Create(count, huge_pages);
+      if (slot < 0) break;
+      slots_[slot]->Prefault();
+      Put(slot);
+    }
+  }
+
+  // Frees buffers unused since last trimmed, returns how many
+  size_t Trim() {
+    auto in_use = refs_.load() - 1;
+    auto keep = std::max(window_peak_.exchange(in_use), reserved_.load());
+    size_t count = 0;
+    while (pooled_.load() > keep) {
+      auto slot = Pop(&free_head_);
+      if (slot < 0) break;
+      delete slots_[slot];
+      slots_[slot] = nullptr;
+      Push(&empty_head_, slot);
+      pooled_.fetch_sub(1);
+      budget_->Release(size_);
+      ++count;
+    }
+    return count;
+  }
+
+  Stats GetStats() const {
+    return {size_, proper(), pooled_.load(), refs_.load() - 1,
+        in_use_peak_.load(), overflows_.load(), failures_.load()};
+  }
+
+ private:
+  // Large enough for the control block of any standard library
+  using block_t = std::aligned_storage<128, alignof(std::max_align_t)>::type;
+
+  // The data of a slot is owned by the slot
+  struct SlotDeleter {
+    void operator()(data_t* /*data*/) const {}
+  };
+
+  struct OverflowDeleter {
+    SizeClass* owner;
+
+    void operator()(data_t* data) const {
+      delete data;
+      owner->CountOut();
+    }
+  };
+
+ public:
+  template <typename T>
+  struct SlotAllocator {
+    using value_type = T;
+
+    SlotAllocator(SizeClass* owner, int slot)
+      : owner(owner), slot(slot) {}
+
+    template <typename U>
+    SlotAllocator(const SlotAllocator<U>& other)  // NOLINT
+      : owner(other.owner), slot(other.slot) {}
+
+    T* allocate(std::size_t n) {
+      return static_cast<T*>(owner->Allocate(slot, n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t /*n*/) {
+      owner->Release(slot, p);
+    }
+
+    template <typename U>
+    bool operator==(const SlotAllocator<U>& other) const {
+      return owner == other.owner && slot == other.slot;
+    }
+
+    template <typename U>
+    bool operator!=(const SlotAllocator<U>& other) const {
+      return !(*this == other);
+    }
+
+    SizeClass* owner;
+    int slot;
+  };
+
+ private:
+  void* Allocate(int slot, std::size_t bytes) {
+    if (bytes <= sizeof(block_t)) return &blocks_[slot];
+    return ::operator new(bytes);
+  }
+
+  void Release(int slot, void* p) {
+    if (p != &blocks_[slot]) ::operator delete(p);
+    Put(slot);
+    CountOut();
+  }
+
+  static std::uint32_t index(std::uint64_t head) {
+    return static_cast<std::uint32_t>(head & 0xffffffffu);
+  }
+
+  static std::uint64_t pack(std::uint64_t head, std::uint32_t index) {
+    return (((head >> 32) + 1) << 32) | index;
+  }
+
+  // index in head and next is slot + 1, 0 means none
+  int Pop(std::atomic<std::uint64_t>* stack) {
+    auto head = stack->load(std::memory_order_acquire);
+    while (index(head) != 0) {
+      auto slot = index(head) - 1;
+      auto next = next_[slot].load(std::memory_order_relaxed);
+      if (stack->compare_exchange_weak(head, pack(head, next),
+          std::memory_order_acquire, std::memory_order_acquire)) {
+        return static_cast<int>(slot);
+      }
+    }
+    return -1;
+  }
+
+  void Push(std::atomic<std::uint64_t>* stack, int slot) {
+    auto head = stack->load(std::memory_order_relaxed);
+    do {
+      next_[slot].store(index(head), std::memory_order_relaxed);
+    } while (!stack->compare_exchange_weak(head, pack(head, slot + 1),
+        std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  // Frees the slot with its buffer
+  void Put(int slot) {
+    Push(&free_head_, slot);
+    if (waiters_.load() > 0) {
+      std::lock_guard<std::mutex> _(mutex_);
+      condition_.notify_one();
+    }
+  }
+
+  // Creates a buffer in an empty slot, -1 if over the capacity or budget
+  int Create(size_t capacity, bool huge_pages) {
+    auto pooled = pooled_.load(std::memory_order_relaxed);
+    do {
+      if (pooled >= capacity) return -1;
+    } while (!pooled_.compare_exchange_weak(pooled, pooled + 1,
+        std::memory_order_relaxed));
+    if (!budget_->Reserve(size_)) {
+      pooled_.fetch_sub(1);
+      return -1;
+    }
+    auto slot = Pop(&empty_head_);
+    if (slot < 0) {
+      auto used = slots_used_.fetch_add(1);
+      if (used >= CACHES_SLOTS_MAX) {
+        // Empty slots are being pushed back by a trim
+        slots_used_.fetch_sub(1);
+        budget_->Release(size_);
+        pooled_.fetch_sub(1);
+        return -1;
+      }
+      slot = static_cast<int>(used);
+    }
+#ifdef CACHES_INFO_PRINT
+    LOGI("Create data: %d, slot: %d", size_, slot);
+#endif
+    slots_[slot] = new data_t(size_, huge_pages);
+    return slot;
+  }
+
+  int Wait(std::uint32_t timeout_ms) {
+    int slot = -1;
+    ++waiters_;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+          [this, &slot] { return (slot = Pop(&free_head_)) >= 0; });
+    }
+    --waiters_;
+    return slot;
+  }
+
+  void CountIn() {
+    auto refs = refs_.fetch_add(1, std::memory_order_relaxed) + 1;
+    update_max(&in_use_peak_, refs - 1);
+    update_max(&window_peak_, refs - 1);
+  }
+
+  void CountOut() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
+
+  const size_t size_;
+  std::atomic<bool> proper_;
+  std::shared_ptr<Budget> budget_;
+
+  std::atomic<std::uint64_t> free_head_;
+  std::atomic<std::uint64_t> empty_head_;
+  std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+  std::unique_ptr<data_t*[]> slots_;
+  std::unique_ptr<block_t[]> blocks_;
+  std::atomic<size_t> slots_used_;
+
+  // 1 of the pool, and 1 of each buffer in use
+  std::atomic<size_t> refs_;
+  std::atomic<size_t> pooled_;
+  // Prewarmed, not trimmed below
+  std::atomic<size_t> reserved_;
+  std::atomic<size_t> in_use_peak_;
+  // Peak in use since last trimmed
+  std::atomic<size_t> window_peak_;
+  std::atomic<size_t> overflows_;
+  std::atomic<size_t> failures_;
+
+  // Blocking gets only
+  std::atomic<int> waiters_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+DataCaches::DataCaches() : DataCaches(std::make_shared<Budget>()) {
+}
+
+DataCaches::DataCaches(const std::shared_ptr<Budget>& budget)
+  : classes_(new std::atomic<SizeClass*>[CACHES_CLASSES_MAX]),
+    classes_count_(0),
+    budget_(budget),
+    capacity_(CACHES_EACH_MAX_SIZE),
+    policy_(static_cast<std::int32_t>(Policy::ALLOCATE)),
+    block_timeout_ms_(1000),
+    huge_pages_(false),
+    idle_timeout_ms_(0),
+    trim_running_(false) {
+  for (int i = 0; i < CACHES_CLASSES_MAX; i++) {
+    classes_[i].store(nullptr, std::memory_order_relaxed);
+  }
 }
 
 DataCaches::~DataCaches() {
+  StopTrim();
+  auto count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    classes_[i].load(std::memory_order_acquire)->Unref();
+  }
 }
 
 void DataCaches::SetProperSizes(std::set<size_t> sizes) {
-  proper_sizes_ = std::vector<size_t>{sizes.begin(), sizes.end()};
-  std::sort(proper_sizes_.begin(), proper_sizes_.end());
+  for (auto&& size : sizes) {
+    Register(size);
+  }
+  auto count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    auto size_class = classes_[i].load(std::memory_order_acquire);
+    size_class->set_proper(sizes.find(size_class->size()) != sizes.end());
+  }
 
 #ifdef CACHES_INFO_PRINT
   std::cout << "proper_sizes: ";
-  std::copy(proper_sizes_.begin(), proper_sizes_.end(),
-      std::ostream_iterator<size_t>(std::cout, ","));
+  for (auto&& size : sizes) {
+    std::cout << size << ",";
+  }
   std::cout << std::endl;
 #endif
 }
 
+void DataCaches::SetCapacity(size_t capacity, const Policy& policy,
+    std::uint32_t block_timeout_ms) {
+  if (capacity > CACHES_SLOTS_MAX) {
+    LOGW("Caches capacity %d is larger than %d, clamped", capacity,
+        CACHES_SLOTS_MAX);
+    capacity = CACHES_SLOTS_MAX;
+  }
+  capacity_.store(capacity);
+  policy_.store(static_cast<std::int32_t>(policy));
+  block_timeout_ms_.store(block_timeout_ms);
+}
+
+DataCaches::size_t DataCaches::GetCapacity() const {
+  return capacity_.load();
+}
+
+DataCaches::Policy DataCaches::GetPolicy() const {
+  return static_cast<Policy>(policy_.load());
+}
+
+DataCaches& DataCaches::Instance(const ImageType& type) {
+  // Images of color and depth share the max bytes
+  static std::shared_ptr<Budget> budget = std::make_shared<Budget>();
+  static DataCaches color_caches(budget);
+  static DataCaches depth_caches(budget);
+  return type == ImageType::IMAGE_DEPTH ? depth_caches : color_caches;
+}
+
+void DataCaches::SetMaxBytes(size_t max_bytes) {
+  budget_->max_bytes.store(max_bytes);
+}
+
+DataCaches::size_t DataCaches::GetMaxBytes() const {
+  return budget_->max_bytes.load();
+}
+
+DataCaches::size_t DataCaches::GetBytes() const {
+  return budget_->bytes.load();
+}
+
+void DataCaches::SetHugePages(bool huge_pages) {
+  huge_pages_.store(huge_pages);
+}
+
+bool DataCaches::GetHugePages() const {
+  return huge_pages_.load();
+}
+
+void DataCaches::Prewarm(const size_t& size, const size_t& count) {
+  auto size_class = Find(size);
+  if (size_class == nullptr) {
+    size_class = Register(size);
+    if (size_class == nullptr) return;
+  }
+  size_class->Prewarm(count, GetHugePages());
+  if (size_class->GetStats().pooled < count) {
+    LOGW("Caches(%d) prewarmed less than %d, limited by the max bytes %d",
+        size, count, GetMaxBytes());
+  }
+}
+
+void DataCaches::SetIdleTimeout(std::uint32_t timeout_ms) {
+  StopTrim();
+  idle_timeout_ms_ = timeout_ms;
+  if (timeout_ms > 0) {
+    trim_running_ = true;
+    trim_thread_ = std::thread(&DataCaches::RunTrim, this);
+  }
+}
+
+std::uint32_t DataCaches::GetIdleTimeout() const {
+  return idle_timeout_ms_;
+}
+
+DataCaches::size_t DataCaches::Trim() {
+  size_t count = 0;
+  auto classes_count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < classes_count; i++) {
+    count += classes_[i].load(std::memory_order_acquire)->Trim();
+  }
+#ifdef CACHES_INFO_PRINT
+  if (count > 0) LOGI("Trim caches: %d", count);
+#endif
+  return count;
+}
+
+void DataCaches::RunTrim() {
+  std::unique_lock<std::mutex> lock(trim_mutex_);
+  auto timeout = std::chrono::milliseconds(idle_timeout_ms_);
+  while (trim_running_) {
+    if (trim_condition_.wait_for(lock, timeout,
+        [this] { return !trim_running_; })) {
+      break;
+    }
+    Trim();
+  }
+}
+
+void DataCaches::StopTrim() {
+  {
+    std::lock_guard<std::mutex> _(trim_mutex_);
+    trim_running_ = false;
+  }
+  trim_condition_.notify_one();
+  if (trim_thread_.joinable()) {
+    trim_thread_.join();
+  }
+}
+
 DataCaches::data_ptr_t DataCaches::GetFixed(const size_t& size) {
-  std::lock_guard<std::mutex> _(mutex_);
-  return Get(size);
+  auto size_class = Find(size);
+  if (size_class == nullptr) {
+    size_class = Register(size);
+  }
+  return Get(size_class, size);
 }
 
 DataCaches::data_ptr_t DataCaches::GetProper(const size_t& size) {
-  std::lock_guard<std::mutex> _(mutex_);
-  auto&& it = std::find_if(proper_sizes_.begin(), proper_sizes_.end(),
-      [&size](const size_t& proper_size) { return proper_size >= size; });
-  if (it == proper_sizes_.end()) {
+  auto size_class = FindProper(size);
+  if (size_class == nullptr) {
     LOGW("GetProper size: %d", size);
     throw_error("The size is larger then all proper sizes, unaccepted");
   }
 #ifdef CACHES_INFO_PRINT
-  LOGI("GetProper size: %d, proper_size: %d", size, *it);
+  LOGI("GetProper size: %d, proper_size: %d", size, size_class->size());
 #endif
-  return Get(*it);
+  return Get(size_class, size_class->size());
 }
 
-DataCaches::data_ptr_t DataCaches::Create(const size_t& size) {
-#ifdef CACHES_INFO_PRINT
-  LOGI("Create data: %d", size);
-#endif
-  return std::make_shared<data_t>(size);
+DataCaches::data_ptr_t DataCaches::Get(SizeClass* size_class,
+    const size_t& size) {
+  if (size_class == nullptr) {
+    // Out of classes, not pooled
+    return std::make_shared<data_t>(size, GetHugePages());
+  }
+  return size_class->Get(capacity_.load(std::memory_order_relaxed),
+      static_cast<Policy>(policy_.load(std::memory_order_relaxed)),
+      block_timeout_ms_.load(std::memory_order_relaxed),
+      huge_pages_.load(std::memory_order_relaxed));
 }
 
-DataCaches::data_ptr_t DataCaches::Get(const size_t& size) {
-  auto&& caches = caches_map_[size];
-  if (!caches.empty()) {
-    for (auto&& data : caches) {
-      if (data.use_count() > 1) {
-        continue;
-      }
-#ifdef CACHES_INFO_PRINT
-      LOGI("Get cache: %d", size);
-#endif
-      return data;
+DataCaches::SizeClass* DataCaches::Find(const size_t& size) const {
+  auto count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    auto size_class = classes_[i].load(std::memory_order_acquire);
+    if (size_class->size() == size) return size_class;
+  }
+  return nullptr;
+}
+
+DataCaches::SizeClass* DataCaches::FindProper(const size_t& size) const {
+  SizeClass* result = nullptr;
+  auto count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    auto size_class = classes_[i].load(std::memory_order_acquire);
+    if (size_class->proper() && size_class->size() >= size &&
+        (result == nullptr || size_class->size() < result->size())) {
+      result = size_class;
     }
   }
-  if (caches.size() > CACHES_EACH_MAX_SIZE) {
-    LOGW("Caches(%d) is too large", size);
+  return result;
+}
+
+DataCaches::SizeClass* DataCaches::Register(const size_t& size) {
+  std::lock_guard<std::mutex> _(mutex_);
+  // May registered by another thread
+  auto found = Find(size);
+  if (found != nullptr) return found;
+
+  auto count = classes_count_.load(std::memory_order_relaxed);
+  if (count >= CACHES_CLASSES_MAX) {
+    LOGW("Caches classes are more than %d, size %d not pooled",
+        CACHES_CLASSES_MAX, size);
+    return nullptr;
+  }
+  auto size_class = new SizeClass(size, budget_);
+  classes_[count].store(size_class, std::memory_order_release);
+  classes_count_.store(count + 1, std::memory_order_release);
+  return size_class;
+}
+
+std::vector<DataCaches::Stats> DataCaches::GetStats() const {
+  std::vector<Stats> stats;
+  auto count = classes_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    stats.push_back(classes_[i].load(std::memory_order_acquire)->GetStats());
   }
-  auto&& data = Create(size);
-  caches.push_back(data);
-  return data;
+  return stats;
 }
 
 void DataCaches::DebugPrint() const {
-  std::cout << "DataCaches" << std::endl;
-  for (auto&& entry : caches_map_) {
-    std::cout << "  size: " << entry.first
-        << ", count: " << entry.second.size()
+  std::cout << "DataCaches, bytes: " << GetBytes()
+      << ", max bytes: " << GetMaxBytes() << std::endl;
+  for (auto&& s : GetStats()) {
+    std::cout << "  size: " << s.size
+        << (s.proper ? " (proper)" : "")
+        << ", count: " << s.pooled
+        << ", in use: " << s.in_use
+        << ", peak: " << s.in_use_peak
+        << ", overflows: " << s.overflows
+        << ", failures: " << s.failures
         << std::endl;
   }
 }
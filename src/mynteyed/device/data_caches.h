@@ -15,46 +15,140 @@
 #define MYNTEYE_DEVICE_DATA_CACHES_H_
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
-#include <list>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <thread>
 #include <vector>
 
+#include "mynteyed/device/image_storage.h"
+#include "mynteyed/device/types.h"
 #include "mynteyed/stubs/global.h"
 
 MYNTEYE_BEGIN_NAMESPACE
 
+/**
+ * Pools data buffers by size class.
+ *
+ * Get and release are lock-free and O(1): each size class keeps its free
+ * buffers on a lock-free stack, and the deleter of the returned data pushes
+ * the buffer back when the last reference drops.
+ */
 class DataCaches {
  public:
   using size_t = std::size_t;
-  using data_t = std::vector<std::uint8_t>;
+  using data_t = ImageStorage;
   using data_ptr_t = std::shared_ptr<data_t>;
-  using caches_t = std::list<data_ptr_t>;
+
+  /** What to do if all the buffers of a size are in use at the capacity. */
+  enum class Policy : std::int32_t {
+    /** Allocate one more, it is freed rather than pooled when released */
+    ALLOCATE = 0,
+    /** Wait a buffer released, fail if timeout */
+    BLOCK = 1,
+    /** Fail at once */
+    FAIL = 2,
+  };
+
+  struct Stats {
+    size_t size;
+    bool proper;
+    // Buffers owned by the pool
+    size_t pooled;
+    // Buffers in use, including the ones over the capacity
+    size_t in_use;
+    // High-water mark of in use
+    size_t in_use_peak;
+    // Buffers allocated over the capacity
+    size_t overflows;
+    // Gets failed, or timeout when blocking
+    size_t failures;
+  };
 
   DataCaches();
   ~DataCaches();
 
+  // The caches of images, depth or color. They share the max bytes.
+  static DataCaches& Instance(const ImageType& type);
+
   void SetProperSizes(std::set<size_t> sizes);
 
-  // Get data with fixed size
+  // Max buffers pooled of each size, and the policy at it
+  void SetCapacity(size_t capacity, const Policy& policy = Policy::ALLOCATE,
+      std::uint32_t block_timeout_ms = 1000);
+  size_t GetCapacity() const;
+  Policy GetPolicy() const;
+
+  // Max bytes of the buffers pooled, 0 means no limit. Over it, the policy
+  // applies as at the capacity.
+  void SetMaxBytes(size_t max_bytes);
+  size_t GetMaxBytes() const;
+  // Bytes of the buffers pooled
+  size_t GetBytes() const;
+
+  // Allocates the large buffers on huge pages, since now
+  void SetHugePages(bool huge_pages);
+  bool GetHugePages() const;
+
+  // Pools count buffers of the size ahead, page faulted. Trimming keeps them.
+  void Prewarm(const size_t& size, const size_t& count);
+
+  // Frees the buffers unused for the timeout in a thread, 0 means never
+  void SetIdleTimeout(std::uint32_t timeout_ms);
+  std::uint32_t GetIdleTimeout() const;
+  // Frees the buffers unused since last trimmed, returns how many
+  size_t Trim();
+
+  // Get data with fixed size, nullptr if failed by the policy
   data_ptr_t GetFixed(const size_t& size);
-  // Get data with proper size
+  // Get data with proper size, nullptr if failed by the policy
   data_ptr_t GetProper(const size_t& size);
 
+  std::vector<Stats> GetStats() const;
+
   void DebugPrint() const;
 
  private:
-  data_ptr_t Create(const size_t& size);
-  data_ptr_t Get(const size_t& size);
+  struct Budget;
+  class SizeClass;
+
+  explicit DataCaches(const std::shared_ptr<Budget>& budget);
+
+  SizeClass* Find(const size_t& size) const;
+  SizeClass* FindProper(const size_t& size) const;
+  SizeClass* Register(const size_t& size);
+
+  data_ptr_t Get(SizeClass* size_class, const size_t& size);
+
+  void RunTrim();
+  void StopTrim();
+
+  // Published classes, lookups read them without lock. A class frees itself
+  // once the pool and all its buffers released it.
+  std::unique_ptr<std::atomic<SizeClass*>[]> classes_;
+  std::atomic<size_t> classes_count_;
+
+  std::shared_ptr<Budget> budget_;
+
+  std::atomic<size_t> capacity_;
+  std::atomic<std::int32_t> policy_;
+  std::atomic<std::uint32_t> block_timeout_ms_;
+  std::atomic<bool> huge_pages_;
 
-  std::map<size_t, caches_t> caches_map_;
+  // Guards registering classes only
+  mutable std::mutex mutex_;
 
-  std::vector<size_t> proper_sizes_;
+  std::uint32_t idle_timeout_ms_;
+  bool trim_running_;
+  std::thread trim_thread_;
+  std::mutex trim_mutex_;
+  std::condition_variable trim_condition_;
 
-  std::mutex mutex_;
+  MYNTEYE_DISABLE_COPY(DataCaches)
+  MYNTEYE_DISABLE_MOVE(DataCaches)
 };
 
 MYNTEYE_END_NAMESPACE
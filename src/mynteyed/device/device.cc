@@ -12,10 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "mynteyed/device/device.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <string>
 
+#include "mynteyed/device/data_caches.h"
 #include "mynteyed/util/log.h"
 
 MYNTEYE_USE_NAMESPACE
@@ -363,6 +366,7 @@ bool Device::Open(const OpenParams& params) {
 
   if (ETronDI_OK == ret) {
     open_params_ = params;
+    ConfigDataCaches(params);
     if (depth_device_opened_) {
       // depth device must be opened.
       SyncCameraCalibrations();
@@ -795,12 +799,76 @@ void Device::SyncCameraCalibrations() {
 void Device::ReleaseBuf() {
   color_image_buf_ = nullptr;
   depth_image_buf_ = nullptr;
-  if (!depth_buf_) {
-    delete depth_buf_;
+  if (depth_buf_) {
+    free(depth_buf_);
     depth_buf_ = nullptr;
   }
 }
 
+void Device::ConfigDataCaches(const OpenParams& params) {
+  // The caches are shared by all devices, the last opened sets them
+  auto&& color_caches = DataCaches::Instance(ImageType::IMAGE_LEFT_COLOR);
+  auto&& depth_caches = DataCaches::Instance(ImageType::IMAGE_DEPTH);
+  color_caches.SetMaxBytes(params.cache_max_bytes);  // depth shares it
+  std::size_t capacity = std::max(params.cache_capacity, 0);
+  auto policy = DataCaches::Policy::ALLOCATE;
+  if (params.cache_policy >= CachePolicy::CACHE_ALLOCATE &&
+      params.cache_policy < CachePolicy::CACHE_POLICY_LAST) {
+    policy = static_cast<DataCaches::Policy>(params.cache_policy);
+  }
+  auto block_timeout_ms = std::max(params.cache_block_timeout_ms, 0);
+  color_caches.SetCapacity(capacity, policy, block_timeout_ms);
+  depth_caches.SetCapacity(capacity, policy, block_timeout_ms);
+  auto idle_timeout_ms = std::max(params.cache_idle_timeout_ms, 0);
+  color_caches.SetIdleTimeout(idle_timeout_ms);
+  depth_caches.SetIdleTimeout(idle_timeout_ms);
+  color_caches.SetHugePages(params.cache_huge_pages);
+  depth_caches.SetHugePages(params.cache_huge_pages);
+  Image::SetRowAlignment(params.align_image_rows ? ImageStorage::ALIGNMENT : 1);
+  ImageDepth::SetGrayRange(params.depth_gray_near, params.depth_gray_far);
+
+  if (params.cache_prewarm_count <= 0) return;
+  std::size_t count = params.cache_prewarm_count;
+  // bytes of a converted row, padded if aligned
+  std::size_t alignment = Image::GetRowAlignment();
+  auto&& step = [alignment](std::size_t row) {
+    return (row + alignment - 1) & ~(alignment - 1);
+  };
+
+  if (params.dev_mode != DeviceMode::DEVICE_DEPTH) {
+    auto&& info = stream_color_info_ptr_[color_res_index_];
+    std::size_t width = info.nWidth, height = info.nHeight;
+    // captured, YUYV or MJPG, 2 bytes per pixel
+    color_caches.Prewarm(width * height * 2, count);
+    // converted to RGB or BGR, each half if dual
+    auto half_width = IsRightColorSupported(params.stream_mode) ?
+        width / 2 : width;
+    color_caches.Prewarm(step(half_width * 3) * height, count);
+    if (half_width != width && info.bFormatMJPG) {
+      // dual MJPG is decoded whole once for both halves
+      color_caches.Prewarm(step(width * 3) * height, count);
+    }
+  }
+
+  if (params.dev_mode != DeviceMode::DEVICE_COLOR) {
+    auto&& info = stream_depth_info_ptr_[depth_res_index_];
+    std::size_t width = info.nWidth, height = info.nHeight;
+    // captured raw, 2 bytes per pixel
+    depth_caches.Prewarm(width * height * 2, count);
+    if (params.depth_mode != DepthMode::DEPTH_RAW) {
+#ifdef MYNTEYE_OS_LINUX
+      if (depth_data_type_ == ETronDI_DEPTH_DATA_8_BITS) {
+        width = width * 2;
+      }
+#endif
+      // gray or colorful, 3 bytes per pixel
+      depth_caches.Prewarm(step(width * 3) * height, count);
+    }
+  }
+
+  DBG_LOGI("Prewarm caches: %d bytes", color_caches.GetBytes());
+}
+
 void Device::CompatibleUSB2(const OpenParams& params) {
   if (!IsUSB2()) {
     return;
@@ -132,6 +132,9 @@ class Device {
   void CompatibleUSB2(const OpenParams& params);
   void CompatibleMJPG(const OpenParams& params);
 
+  /** Set the caches of images, prewarm the sizes of opened streams */
+  void ConfigDataCaches(const OpenParams& params);
+
  private:
   void Init();
   void OnInit();  // cross
@@ -168,8 +171,10 @@ class Device {
   int depth_serial_number_ = 0;
   image_size_t color_image_size_ = 0;
   image_size_t depth_image_size_ = 0;
+  // Latest frames captured by the callback, not taken yet; on win
   Image::pointer color_image_buf_ = nullptr;
   Image::pointer depth_image_buf_ = nullptr;
+  // Raw depth to transfer to gray or colorful; on linux
   unsigned char* depth_buf_ = nullptr;
 
 #ifdef MYNTEYE_OS_WIN
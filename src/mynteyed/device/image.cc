@@ -13,6 +13,12 @@
 // limitations under the License.
 #include "mynteyed/device/image.h"
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "mynteyed/device/convert_engine.h"
 #include "mynteyed/device/convertor.h"
 #include "mynteyed/device/data_caches.h"
 // #include "mynteyed/internal/image_utils.h"
@@ -37,11 +43,15 @@ int get_image_bpp(const ImageFormat& format) {
   }
 }
 
-int get_image_size(const ImageFormat& format, const int& width,
-    const int& height) {
-  return width * height * get_image_bpp(format);
+// Rows of the raw formats are allocated packed, as the device fills them so
+bool is_image_packed(const ImageFormat& format) {
+  return format == ImageFormat::IMAGE_YUYV || format == ImageFormat::IMAGE_MJPG;
 }
 
+std::atomic<std::size_t> image_row_alignment(1);
+// far << 16 | near, 0 means of the min and max
+std::atomic<std::uint32_t> depth_gray_range(0);
+
 #ifdef WITH_OPENCV
 int get_mat_type(const ImageFormat& format) {
   switch (format) {
@@ -56,10 +66,6 @@ int get_mat_type(const ImageFormat& format) {
 }
 #endif
 
-// Global data caches
-DataCaches g_data_caches;
-DataCaches g_depth_data_caches;
-
 void init_cache_proper_sizes() {
   std::set<std::size_t> sizes;
 
@@ -74,32 +80,31 @@ void init_cache_proper_sizes() {
     }
   }
 
-  g_data_caches.SetProperSizes(sizes);
-  g_depth_data_caches.SetProperSizes(sizes);
+  DataCaches::Instance(ImageType::IMAGE_LEFT_COLOR).SetProperSizes(sizes);
+  DataCaches::Instance(ImageType::IMAGE_DEPTH).SetProperSizes(sizes);
 }
 
 DataCaches::data_ptr_t get_cache_fixed(const ImageType& type,
     const std::size_t& size) {
-  if (type == ImageType::IMAGE_DEPTH) {
-    return g_depth_data_caches.GetFixed(size);
-  } else {
-    return g_data_caches.GetFixed(size);
-  }
+  return DataCaches::Instance(type).GetFixed(size);
 }
 
 DataCaches::data_ptr_t get_cache_proper(const ImageType& type,
     const std::size_t& size) {
-  if (type == ImageType::IMAGE_DEPTH) {
-    return g_depth_data_caches.GetProper(size);
-  } else {
-    return g_data_caches.GetProper(size);
-  }
+  return DataCaches::Instance(type).GetProper(size);
 }
 
 Image::pointer get_cache_image(const Image::pointer& image,
     const ImageFormat& format, int width, int height) {
-  auto&& result = Image::Create(image->type(), format, width, height, false);
+  std::size_t step = width * get_image_bpp(format);
+  std::size_t alignment = image_row_alignment;
+  if (alignment > 1) {
+    step = (step + alignment - 1) & ~(alignment - 1);
+  }
+  auto&& result = Image::Create(image->type(), format, width, height, false,
+      step);
   result->set_frame_id(image->frame_id());
+  result->set_host_timestamp(image->host_timestamp());
   result->set_is_dual(image->is_dual());
   return result;
 }
@@ -109,25 +114,107 @@ Image::pointer get_cache_image(const Image::pointer& image,
   return get_cache_image(image, format, image->width(), image->height());
 }
 
+void mjpg_decode(std::uint8_t* jpg, std::size_t size, std::uint8_t* out,
+    const ImageFormat& format, std::size_t step) {
+  switch (format) {
+    case ImageFormat::COLOR_RGB: MJPEG_TO_RGB(jpg, size, out, step); break;
+    case ImageFormat::COLOR_BGR: MJPEG_TO_BGR(jpg, size, out, step); break;
+    case ImageFormat::COLOR_GRAY: MJPEG_TO_GRAY(jpg, size, out, step); break;
+    default: throw new std::runtime_error("ImageFormat not supported");
+  }
+}
+
+void mjpg_decode_half(std::uint8_t* jpg, std::size_t size, std::uint8_t* out,
+    const ImageFormat& format, bool left, int width, int height,
+    std::size_t step) {
+  switch (format) {
+    case ImageFormat::COLOR_RGB:
+      if (left) {
+        MJPEG_TO_RGB_LEFT(jpg, size, out, width, height, step);
+      } else {
+        MJPEG_TO_RGB_RIGHT(jpg, size, out, width, height, step);
+      }
+      break;
+    case ImageFormat::COLOR_BGR:
+      if (left) {
+        MJPEG_TO_BGR_LEFT(jpg, size, out, width, height, step);
+      } else {
+        MJPEG_TO_BGR_RIGHT(jpg, size, out, width, height, step);
+      }
+      break;
+    case ImageFormat::COLOR_GRAY:
+      if (left) {
+        MJPEG_TO_GRAY_LEFT(jpg, size, out, width, height, step);
+      } else {
+        MJPEG_TO_GRAY_RIGHT(jpg, size, out, width, height, step);
+      }
+      break;
+    default: throw new std::runtime_error("ImageFormat not supported");
+  }
+}
+
 }  // namespace
 
+struct Image::DecodeCache {
+  using decode_t = std::function<Image::pointer()>;
+
+  // Shadows created over the data
+  std::atomic<int> shadows;
+
+  std::map<ImageFormat, Image::pointer> images;
+  std::mutex mutex;
+
+  DecodeCache() : shadows(0) {}
+
+  // Decode at first, others wait and share the result
+  Image::pointer Get(const ImageFormat& format, decode_t decode) {
+    std::lock_guard<std::mutex> _(mutex);
+    auto&& it = images.find(format);
+    if (it != images.end()) return it->second;
+    auto&& image = decode();
+    images[format] = image;
+    return image;
+  }
+};
+
 Image::Image(const ImageType& type, const ImageFormat& format,
-    int width, int height, bool is_buffer)
+    int width, int height, bool is_buffer, std::size_t step,
+    const data_ptr_t& data, std::size_t offset)
   : type_(type),
     format_(format),
     width_(width),
     height_(height),
     is_buffer_(is_buffer),
+    step_(0),
+    offset_(0),
+    is_view_(false),
     raw_format_(format),
     frame_id_(0),
+    host_timestamp_(0),
     is_dual_(false) {
   static bool is_cache_proper_sizes_set = false;
   if (!is_cache_proper_sizes_set) {
     init_cache_proper_sizes();
     is_cache_proper_sizes_set = true;
   }
-  auto&& n = get_image_size(format, width, height);
+  std::size_t row = width * get_image_bpp(format);
+  step_ = row;
+  if (data) {
+    // View rows of the data
+    if (step > step_) step_ = step;
+    data_ = data;
+    offset_ = offset;
+    valid_size_ = height > 0 ? step_ * (height - 1) + row : 0;
+    return;
+  }
+  if (step > step_ && !is_image_packed(format)) {
+    step_ = step;
+  }
+  std::size_t n = step_ * height;
   data_ = get_cache_fixed(type_, n);
+  if (!data_) {
+    throw_error("Image data caches are exhausted");
+  }
   set_valid_size(n);
 }
 
@@ -135,57 +222,163 @@ Image::~Image() {
 }
 
 Image::pointer Image::Create(const ImageType& type, const ImageFormat& format,
-    int width, int height, bool is_buffer) {
+    int width, int height, bool is_buffer, std::size_t step) {
+  switch (type) {
+    case ImageType::IMAGE_LEFT_COLOR:
+    case ImageType::IMAGE_RIGHT_COLOR:
+      return ImageColor::Create(type, format, width, height, is_buffer, step);
+    case ImageType::IMAGE_DEPTH:
+      return ImageDepth::Create(format, width, height, is_buffer, step);
+    default:
+      throw new std::runtime_error("ImageType must be color or depth");
+  }
+}
+
+Image::pointer Image::Create(const ImageType& type, const ImageFormat& format,
+    int width, int height, std::size_t step, const data_ptr_t& data,
+    std::size_t offset) {
   switch (type) {
     case ImageType::IMAGE_LEFT_COLOR:
     case ImageType::IMAGE_RIGHT_COLOR:
-      return ImageColor::Create(type, format, width, height, is_buffer);
+      return pointer(new ImageColor(type, format, width, height, false, step,
+          data, offset));
     case ImageType::IMAGE_DEPTH:
-      return ImageDepth::Create(format, width, height, is_buffer);
+      return pointer(new ImageDepth(format, width, height, false, step, data,
+          offset));
     default:
       throw new std::runtime_error("ImageType must be color or depth");
   }
 }
 
+void Image::SetRowAlignment(std::size_t alignment) {
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+    LOGW("Row alignment must be a power of 2, %zu ignored", alignment);
+    return;
+  }
+  image_row_alignment = alignment;
+}
+
+std::size_t Image::GetRowAlignment() {
+  return image_row_alignment;
+}
+
 void Image::set_valid_size(std::size_t valid_size) {
   if (valid_size > data_size()) {
     // resize data to valid size
-    data_ = get_cache_proper(type_, valid_size);
+    auto&& data = get_cache_proper(type_, valid_size);
+    if (!data) {
+      throw_error("Image data caches are exhausted");
+    }
+    data_ = data;
+    offset_ = 0;
   }
   valid_size_ = valid_size;
 }
 
 #ifdef WITH_OPENCV
 cv::Mat Image::ToMat() {
-  return cv::Mat(height_, width_, get_mat_type(format_), data());
+  return cv::Mat(height_, width_, get_mat_type(format_), data(), step_);
 }
 #endif
 
 Image::pointer Image::Clone() const {
-  auto image = Create(type_, format_, width_, height_, false);
+  auto image = Create(type_, format_, width_, height_, false,
+      is_view_ ? 0 : step_);
   image->set_frame_id(frame_id_);
+  image->set_host_timestamp(host_timestamp_);
   image->set_is_dual(is_dual_);
+  if (image->step_ != step_) {
+    // Packs the rows of a view
+    std::size_t row = width_ * get_image_bpp(format_);
+    for (int i = 0; i < height_; ++i) {
+      auto&& src = data() + i * step_;
+      std::copy(src, src + row, image->data() + i * image->step_);
+    }
+    return image;
+  }
   image->set_valid_size(valid_size_);
   // The valid size of some compress format will much smaller, e.g. MJPG.
   // Therefore, we could only copy valid data to another.
-  std::copy(data_->begin(), data_->begin() + valid_size_,
-      image->data_->begin());
+  std::copy(data(), data() + valid_size_, image->data());
   return image;
 }
 
 Image::pointer Image::Shadow(const ImageType& type) const {
-  auto image = Create(type, format_, width_, height_, false);
+  // Set data to this
+  auto image = Create(type, format_, width_, height_, step_, data_, offset_);
   image->set_frame_id(frame_id_);
+  image->set_host_timestamp(host_timestamp_);
   image->set_is_dual(is_dual_);
   image->set_valid_size(valid_size_);
-  // Set data to this
-  image->data_ = data_;
+  image->is_view_ = is_view_;
+  // Share decoded images with this and other shadows
+  if (!decode_cache_) {
+    decode_cache_ = std::make_shared<DecodeCache>();
+  }
+  ++decode_cache_->shadows;
+  image->decode_cache_ = decode_cache_;
+  return image;
+}
+
+Image::pointer Image::View(const Roi& roi) const {
+  return View(roi, type_);
+}
+
+Image::pointer Image::View(const Roi& roi, const ImageType& type) const {
+  if (format_ == ImageFormat::IMAGE_MJPG) {
+    throw_error("Could not view a MJPG image");
+  }
+  if (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0
+      || roi.x + roi.width > width_ || roi.y + roi.height > height_) {
+    throw_error(strings::format_string("View roi (%d,%d,%d,%d) out of %dx%d",
+        roi.x, roi.y, roi.width, roi.height, width_, height_));
+  }
+  if (format_ == ImageFormat::IMAGE_YUYV
+      && (roi.x % 2 != 0 || roi.width % 2 != 0)) {
+    throw_error("View of YUYV must be at even x and width");
+  }
+  std::size_t offset = offset_ + roi.y * step_
+      + roi.x * get_image_bpp(format_);
+  auto image = Create(type, format_, roi.width, roi.height, step_, data_,
+      offset);
+  image->set_frame_id(frame_id_);
+  image->set_host_timestamp(host_timestamp_);
+  image->is_view_ = true;
+  return image;
+}
+
+Image::pointer Image::View() const {
+  if (!is_dual_) {
+    return View(Roi{0, 0, width_, height_});
+  }
+  int half = width_ / 2;
+  switch (type_) {
+    case ImageType::IMAGE_LEFT_COLOR:
+      return View(Roi{0, 0, half, height_});
+    case ImageType::IMAGE_RIGHT_COLOR:
+      return View(Roi{half, 0, half, height_});
+    default:
+      throw new std::runtime_error("ImageType of dual must be color");
+  }
+}
+
+Image::pointer Image::Memoize(const ImageFormat& format,
+    std::function<pointer()> convert) {
+  // Others wait the first, then share its result
+  std::lock_guard<std::mutex> _(converted_mutex_);
+  auto&& it = converted_.find(format);
+  if (it != converted_.end()) return it->second;
+  auto&& image = convert();
+  converted_[format] = image;
   return image;
 }
 
 bool Image::ResetBuffer() {
   if (is_buffer_) {
     format_ = raw_format_;
+    // Filled with a new frame
+    std::lock_guard<std::mutex> _(converted_mutex_);
+    converted_.clear();
     return true;
   }
   LOGW("Reset buffer, but it's not a buffer.");
@@ -195,18 +388,21 @@ bool Image::ResetBuffer() {
 // ImageColor
 
 ImageColor::ImageColor(const ImageType& type, const ImageFormat& format,
-    int width, int height, bool is_buffer)
-  : Image(type, format, width, height, is_buffer) {
+    int width, int height, bool is_buffer, std::size_t step,
+    const data_ptr_t& data, std::size_t offset)
+  : Image(type, format, width, height, is_buffer, step, data, offset) {
 }
 
 ImageColor::~ImageColor() {
 }
 
 ImageColor::pointer ImageColor::Create(const ImageType& type,
-    const ImageFormat& format, int width, int height, bool is_buffer) {
+    const ImageFormat& format, int width, int height, bool is_buffer,
+    std::size_t step) {
   if (type == ImageType::IMAGE_LEFT_COLOR
       || type == ImageType::IMAGE_RIGHT_COLOR) {
-    return pointer(new ImageColor(type, format, width, height, is_buffer));
+    return pointer(new ImageColor(type, format, width, height, is_buffer,
+        step));
   } else {
     throw new std::runtime_error("ImageType must be color");
   }
@@ -217,21 +413,27 @@ Image::pointer ImageColor::To(const ImageFormat& format) {
   if (format == format_) {
     return shared_from_this();
   }
+  return Memoize(format, [this, &format]() { return Convert(format); });
+}
+
+Image::pointer ImageColor::Convert(const ImageFormat& format) {
   switch (format_) {  // src
     case ImageFormat::COLOR_BGR:
       if (is_dual_) goto to_fail;
       if (format == ImageFormat::COLOR_RGB) {
-        BGR_TO_RGB(data(), width_, height_);
-        format_ = format;
-        return shared_from_this();
+        auto image = get_cache_image(shared_from_this(), format);
+        BGR_TO_RGB_COPY(data(), image->data(), width_, height_, step_,
+            image->step());
+        return image;
       }
       break;
     case ImageFormat::COLOR_RGB:
       if (is_dual_) goto to_fail;
       if (format == ImageFormat::COLOR_BGR) {
-        RGB_TO_BGR(data(), width_, height_);
-        format_ = format;
-        return shared_from_this();
+        auto image = get_cache_image(shared_from_this(), format);
+        RGB_TO_BGR_COPY(data(), image->data(), width_, height_, step_,
+            image->step());
+        return image;
       }
       break;
     case ImageFormat::COLOR_YUYV:
@@ -262,17 +464,31 @@ Image::pointer ImageColor::To(const ImageFormat& format) {
         image->set_is_dual(false);
         if (format == ImageFormat::COLOR_RGB) {
           if (type_ == ImageType::IMAGE_LEFT_COLOR) {
-            YUYV_TO_RGB_LEFT(data(), image->data(), width_, height_);
+            YUYV_TO_RGB_LEFT(data(), image->data(), width_, height_,
+                image->step());
           } else if (type_ == ImageType::IMAGE_RIGHT_COLOR) {
-            YUYV_TO_RGB_RIGHT(data(), image->data(), width_, height_);
+            YUYV_TO_RGB_RIGHT(data(), image->data(), width_, height_,
+                image->step());
           } else {
             goto to_fail;
           }
         } else if (format == ImageFormat::COLOR_BGR) {
           if (type_ == ImageType::IMAGE_LEFT_COLOR) {
-            YUYV_TO_BGR_LEFT(data(), image->data(), width_, height_);
+            YUYV_TO_BGR_LEFT(data(), image->data(), width_, height_,
+                image->step());
           } else if (type_ == ImageType::IMAGE_RIGHT_COLOR) {
-            YUYV_TO_BGR_RIGHT(data(), image->data(), width_, height_);
+            YUYV_TO_BGR_RIGHT(data(), image->data(), width_, height_,
+                image->step());
+          } else {
+            goto to_fail;
+          }
+        } else if (format == ImageFormat::COLOR_GRAY) {
+          if (type_ == ImageType::IMAGE_LEFT_COLOR) {
+            YUYV_TO_GRAY_LEFT(data(), image->data(), width_, height_,
+                image->step());
+          } else if (type_ == ImageType::IMAGE_RIGHT_COLOR) {
+            YUYV_TO_GRAY_RIGHT(data(), image->data(), width_, height_,
+                image->step());
           } else {
             goto to_fail;
           }
@@ -283,9 +499,14 @@ Image::pointer ImageColor::To(const ImageFormat& format) {
       } else {
         auto image = get_cache_image(shared_from_this(), format);
         if (format == ImageFormat::COLOR_RGB) {
-          YUYV_TO_RGB(data(), image->data(), width_, height_);
+          YUYV_TO_RGB(data(), image->data(), width_, height_,
+              image->step(), step_);
         } else if (format == ImageFormat::COLOR_BGR) {
-          YUYV_TO_BGR(data(), image->data(), width_, height_);
+          YUYV_TO_BGR(data(), image->data(), width_, height_,
+              image->step(), step_);
+        } else if (format == ImageFormat::COLOR_GRAY) {
+          YUYV_TO_GRAY(data(), image->data(), width_, height_,
+              image->step(), step_);
         } else {
           goto to_fail;
         }
@@ -293,44 +514,54 @@ Image::pointer ImageColor::To(const ImageFormat& format) {
       }
       break;
     case ImageFormat::COLOR_MJPG:
-      if (format == ImageFormat::COLOR_RGB) {
-        auto image = get_cache_image(shared_from_this(),
-            ImageFormat::COLOR_RGB);
-        MJPEG_TO_RGB_LIBJPEG(data(), valid_size_, image->data());
-        if (is_dual_) {
-          auto half = get_cache_image(shared_from_this(),
-              ImageFormat::COLOR_RGB, width_ / 2, height_);
-          half->set_is_dual(false);
-          if (type_ == ImageType::IMAGE_LEFT_COLOR) {
-            RGB_TO_RGB_LEFT(image->data(), half->data(), width_, height_);
-          } else if (type_ == ImageType::IMAGE_RIGHT_COLOR) {
-            RGB_TO_RGB_RIGHT(image->data(), half->data(), width_, height_);
+      if (format != ImageFormat::COLOR_RGB
+          && format != ImageFormat::COLOR_BGR
+          && format != ImageFormat::COLOR_GRAY) {
+        break;
+      }
+      if (is_dual_) {
+        auto half = get_cache_image(shared_from_this(), format,
+            width_ / 2, height_);
+        half->set_is_dual(false);
+        bool left = (type_ == ImageType::IMAGE_LEFT_COLOR);
+        if (!left && type_ != ImageType::IMAGE_RIGHT_COLOR) goto to_fail;
+        if (decode_cache_ && decode_cache_->shadows > 1) {
+          // Both halves wanted, decode whole once and split for each
+          auto image = decode_cache_->Get(format, [this, &format]() {
+            auto whole = get_cache_image(shared_from_this(), format);
+            mjpg_decode(data(), valid_size_, whole->data(), format,
+                whole->step());
+            return whole;
+          });
+          if (format == ImageFormat::COLOR_GRAY) {
+            if (left) {
+              GRAY_TO_GRAY_LEFT(image->data(), half->data(), width_, height_,
+                  image->step(), half->step());
+            } else {
+              GRAY_TO_GRAY_RIGHT(image->data(), half->data(), width_,
+                  height_, image->step(), half->step());
+            }
           } else {
-            goto to_fail;
+            if (left) {
+              RGB_TO_RGB_LEFT(image->data(), half->data(), width_, height_,
+                  image->step(), half->step());
+            } else {
+              RGB_TO_RGB_RIGHT(image->data(), half->data(), width_, height_,
+                  image->step(), half->step());
+            }
           }
           return half;  // left or right
         }
+        // Decode the columns of this half only
+        mjpg_decode_half(data(), valid_size_, half->data(), format, left,
+            width_, height_, half->step());
+        return half;  // left or right
+      } else {
+        // Decode to rgb, bgr or gray directly, no pass after
+        auto image = get_cache_image(shared_from_this(), format);
+        mjpg_decode(data(), valid_size_, image->data(), format,
+            image->step());
         return image;  // left only
-      } else if (format == ImageFormat::COLOR_BGR) {
-        // return To(ImageFormat::COLOR_RGB)->To(ImageFormat::COLOR_BGR);
-        auto image = get_cache_image(shared_from_this(),
-            ImageFormat::COLOR_RGB);
-        MJPEG_TO_RGB_LIBJPEG(data(), valid_size_, image->data());
-        if (is_dual_) {
-          auto half = get_cache_image(shared_from_this(),
-              ImageFormat::COLOR_BGR, width_ / 2, height_);
-          half->set_is_dual(false);
-          // Split from rgb to bgr directly
-          if (type_ == ImageType::IMAGE_LEFT_COLOR) {
-            RGB_TO_BGR_LEFT(image->data(), half->data(), width_, height_);
-          } else if (type_ == ImageType::IMAGE_RIGHT_COLOR) {
-            RGB_TO_BGR_RIGHT(image->data(), half->data(), width_, height_);
-          } else {
-            goto to_fail;
-          }
-          return half;  // left or right
-        }
-        return image->To(ImageFormat::COLOR_BGR);  // left only
       }
       break;
     default: break;
@@ -343,58 +574,70 @@ to_fail:
 // ImageDepth
 
 ImageDepth::ImageDepth(const ImageFormat& format, int width, int height,
-    bool is_buffer)
-  : Image(ImageType::IMAGE_DEPTH, format, width, height, is_buffer) {
+    bool is_buffer, std::size_t step, const data_ptr_t& data,
+    std::size_t offset)
+  : Image(ImageType::IMAGE_DEPTH, format, width, height, is_buffer, step,
+      data, offset) {
 }
 
 ImageDepth::~ImageDepth() {
 }
 
+void ImageDepth::SetGrayRange(std::uint16_t depth_near,
+    std::uint16_t depth_far) {
+  if (depth_near >= depth_far) {
+    depth_gray_range = 0;
+    return;
+  }
+  depth_gray_range = static_cast<std::uint32_t>(depth_far) << 16 | depth_near;
+}
+
+void ImageDepth::GetGrayRange(std::uint16_t* depth_near,
+    std::uint16_t* depth_far) {
+  std::uint32_t range = depth_gray_range;
+  *depth_near = range & 0xffff;
+  *depth_far = range >> 16;
+}
+
 Image::pointer ImageDepth::To(const ImageFormat& format) {
   // LOGI(strings::format_string("depth src: %d, dst: %d", format_, format));
   if (format == format_) {
     return shared_from_this();
   }
+  return Memoize(format, [this, &format]() { return Convert(format); });
+}
+
+Image::pointer ImageDepth::Convert(const ImageFormat& format) {
   switch (format_) {  // src
     case ImageFormat::DEPTH_RAW:
       if (format == ImageFormat::DEPTH_GRAY) {
-        std::uint16_t* depths = reinterpret_cast<std::uint16_t*>(data());
-        std::uint16_t depth, depth_min, depth_max;
-        depth = depth_min = depth_max = *(depths);
-        for (int i = 0; i < height_; ++i) {  // row
-          for (int j = 0; j < width_; ++j) {  // col
-            depth = *(depths + (i * width_) + j);
-            if (depth < depth_min) depth_min = depth;
-            if (depth > depth_max) depth_max = depth;
-          }
-        }
-
         auto image = get_cache_image(shared_from_this(), format);
-        auto data = image->data();
-        int offset;
-        std::uint16_t depth_dist = depth_max - depth_min;
-        for (int i = 0; i < height_; ++i) {  // row
-          for (int j = 0; j < width_; ++j) {  // col
-            offset = (i * width_) + j;
-            depth = *(depths + offset);
-            *(data + offset) = 255 * (depth - depth_min) / depth_dist;
-          }
+        std::uint32_t range = depth_gray_range;
+        std::uint16_t depth_near = range & 0xffff, depth_far = range >> 16;
+        if (depth_near < depth_far) {
+          DEPTH_TO_GRAY_RANGE(data(), image->data(), width_, height_,
+              depth_near, depth_far, step_, image->step());
+        } else {
+          DEPTH_TO_GRAY(data(), image->data(), width_, height_, step_,
+              image->step());
         }
         return image;
       }
       break;
     case ImageFormat::DEPTH_BGR:
       if (format == ImageFormat::DEPTH_RGB) {
-        BGR_TO_RGB(data(), width_, height_);
-        format_ = format;
-        return shared_from_this();
+        auto image = get_cache_image(shared_from_this(), format);
+        BGR_TO_RGB_COPY(data(), image->data(), width_, height_, step_,
+            image->step());
+        return image;
       }
       break;
     case ImageFormat::DEPTH_RGB:
       if (format == ImageFormat::DEPTH_BGR) {
-        RGB_TO_BGR(data(), width_, height_);
-        format_ = format;
-        return shared_from_this();
+        auto image = get_cache_image(shared_from_this(), format);
+        RGB_TO_BGR_COPY(data(), image->data(), width_, height_, step_,
+            image->step());
+        return image;
       }
       break;
     default: break;
@@ -0,0 +1,90 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/device/image_storage.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef MYNTEYE_OS_WIN
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "mynteyed/util/log.h"
+
+#define STORAGE_PAGE_SIZE 4096
+#define STORAGE_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+std::uint8_t* storage_alloc(std::size_t alignment, std::size_t size) {
+  if (size == 0) size = alignment;
+#ifdef MYNTEYE_OS_WIN
+  void* p = _aligned_malloc(size, alignment);
+#else
+  void* p = nullptr;
+  if (posix_memalign(&p, alignment, size) != 0) p = nullptr;
+#endif
+  if (p == nullptr) throw std::bad_alloc();
+  return static_cast<std::uint8_t*>(p);
+}
+
+void storage_free(std::uint8_t* p) {
+#ifdef MYNTEYE_OS_WIN
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+}  // namespace
+
+const std::size_t ImageStorage::ALIGNMENT;
+
+ImageStorage::ImageStorage(std::size_t size, bool huge_pages)
+  : data_(nullptr), size_(size), huge_pages_(false) {
+#if defined(MYNTEYE_OS_LINUX) && defined(MADV_HUGEPAGE)
+  if (huge_pages && size >= STORAGE_HUGE_PAGE_SIZE) {
+    // Whole huge pages, so the tail is backed by one too
+    auto n = (size + STORAGE_HUGE_PAGE_SIZE - 1) / STORAGE_HUGE_PAGE_SIZE;
+    data_ = storage_alloc(STORAGE_HUGE_PAGE_SIZE, n * STORAGE_HUGE_PAGE_SIZE);
+    if (madvise(data_, n * STORAGE_HUGE_PAGE_SIZE, MADV_HUGEPAGE) == 0) {
+      huge_pages_ = true;
+    } else {
+      DBG_LOGI("Advise huge pages failed, size: %zu", size);
+    }
+    return;
+  }
+#else
+  UNUSED(huge_pages);
+#endif
+  data_ = storage_alloc(ALIGNMENT, size);
+}
+
+ImageStorage::~ImageStorage() {
+  storage_free(data_);
+}
+
+void ImageStorage::Prefault() {
+  std::size_t page = huge_pages_ ? STORAGE_HUGE_PAGE_SIZE : STORAGE_PAGE_SIZE;
+  for (std::size_t i = 0; i < size_; i += page) {
+    data_[i] = 0;
+  }
+  if (size_ > 0) data_[size_ - 1] = 0;
+}
+
+MYNTEYE_END_NAMESPACE
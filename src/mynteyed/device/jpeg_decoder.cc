@@ -0,0 +1,266 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/device/jpeg_decoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WITH_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#include "mynteyed/device/convertor.h"
+#include "mynteyed/util/log.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+#ifdef WITH_JPEG
+
+namespace {
+
+METHODDEF(void)
+my_error_exit(j_common_ptr cinfo) {
+  /* cinfo->err really points to a my_error_mgr struct, so coerce pointer */
+  my_error_ptr myerr = (my_error_ptr) cinfo->err;
+
+  /* Always display the message. */
+  /* We could postpone this until after returning, if we chose. */
+  (*cinfo->err->output_message) (cinfo);
+
+  /* Return control to the setjmp point */
+  longjmp(myerr->setjmp_buffer, 1);
+}
+
+}  // namespace
+
+#endif
+
+struct JpegDecoder::Impl {
+#ifdef WITH_TURBOJPEG
+  tjhandle handle;
+#endif
+#ifdef WITH_JPEG
+  struct jpeg_decompress_struct cinfo;
+  struct my_error_mgr jerr;
+#endif
+
+  Impl() {
+#ifdef WITH_TURBOJPEG
+    handle = tjInitDecompress();
+    if (handle == nullptr) {
+      LOGE("TurboJPEG init failed: %s", tjGetErrorStr());
+    }
+#endif
+#ifdef WITH_JPEG
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = my_error_exit;
+    jpeg_create_decompress(&cinfo);
+#endif
+  }
+
+  ~Impl() {
+#ifdef WITH_TURBOJPEG
+    if (handle != nullptr) {
+      tjDestroy(handle);
+    }
+#endif
+#ifdef WITH_JPEG
+    jpeg_destroy_decompress(&cinfo);
+#endif
+  }
+
+#ifdef WITH_TURBOJPEG
+  bool DecodeTurbo(const std::uint8_t* jpg, std::size_t size,
+      std::uint8_t* out, const Pixel& pixel, std::size_t step = 0) {
+    unsigned char* buf = const_cast<unsigned char*>(jpg);
+    unsigned long len = static_cast<unsigned long>(size);  // NOLINT
+    int width, height, subsamp, colorspace;
+    if (tjDecompressHeader3(handle, buf, len, &width, &height, &subsamp,
+        &colorspace) != 0) {
+      LOGE("TurboJPEG read header failed: %s", tjGetErrorStr());
+      return false;
+    }
+    int pixel_format;
+    switch (pixel) {
+      case PIXEL_BGR: pixel_format = TJPF_BGR; break;
+      case PIXEL_GRAY: pixel_format = TJPF_GRAY; break;
+      case PIXEL_RGB:
+      default: pixel_format = TJPF_RGB; break;
+    }
+    if (tjDecompress2(handle, buf, len, out, width, static_cast<int>(step),
+        height, pixel_format, 0) != 0) {
+      LOGE("TurboJPEG decompress failed: %s", tjGetErrorStr());
+      return false;
+    }
+    return true;
+  }
+#endif
+
+#ifdef WITH_JPEG
+  // crop_width > 0: decodes columns [crop_x, crop_x + crop_width) only
+  bool DecodeLibjpeg(const std::uint8_t* jpg, std::size_t size,
+      std::uint8_t* out, const Pixel& pixel, unsigned int crop_x = 0,
+      unsigned int crop_width = 0, std::size_t step = 0) {
+    bool swap_rb = false;
+
+    if (setjmp(jerr.setjmp_buffer)) {
+      // Keep the decompressor for the next frame
+      jpeg_abort_decompress(&cinfo);
+      return false;
+    }
+
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(jpg), size);
+
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+      LOGE("Error: File does not seem to be a normal JPEG !!");
+      jpeg_abort_decompress(&cinfo);
+      return false;
+    }
+
+    switch (pixel) {
+      case PIXEL_BGR:
+#ifdef JCS_EXTENSIONS
+        cinfo.out_color_space = JCS_EXT_BGR;
+#else
+        cinfo.out_color_space = JCS_RGB;
+        swap_rb = true;
+#endif
+        break;
+      case PIXEL_GRAY:
+        cinfo.out_color_space = JCS_GRAYSCALE;
+        break;
+      case PIXEL_RGB:
+      default:
+        cinfo.out_color_space = JCS_RGB;
+        break;
+    }
+
+    jpeg_start_decompress(&cinfo);
+
+    if (crop_width == 0 || crop_x + crop_width > cinfo.output_width) {
+      crop_x = 0;
+      crop_width = cinfo.output_width;
+    }
+    JDIMENSION out_x = crop_x, out_width = crop_width;
+#ifdef WITH_JPEG_CROP
+    if (crop_width < cinfo.output_width) {
+      // Widen to iMCU boundaries, the halves of stereo frames are aligned
+      jpeg_crop_scanline(&cinfo, &out_x, &out_width);
+    }
+#else
+    out_x = 0;
+    out_width = cinfo.output_width;
+#endif
+
+    unsigned int comps = cinfo.output_components;
+    unsigned int row_bytes = crop_width * comps;
+    std::size_t row_stride = step > 0 ? step : row_bytes;
+    unsigned char *buffer_array[1];
+    if (out_x == crop_x && out_width == crop_width) {
+      while (cinfo.output_scanline < cinfo.output_height) {
+        buffer_array[0] = out + (cinfo.output_scanline) * row_stride;
+        jpeg_read_scanlines(&cinfo, buffer_array, 1);
+      }
+    } else {
+      // Decode the wider row, then copy the wanted columns
+      row.resize(out_width * comps);
+      buffer_array[0] = row.data();
+      const unsigned char* src = row.data() + (crop_x - out_x) * comps;
+      while (cinfo.output_scanline < cinfo.output_height) {
+        unsigned char* dst = out + (cinfo.output_scanline) * row_stride;
+        jpeg_read_scanlines(&cinfo, buffer_array, 1);
+        std::copy(src, src + row_bytes, dst);
+      }
+    }
+
+    if (swap_rb) {
+      RGB_TO_BGR(out, crop_width, cinfo.output_height, row_stride);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    return true;
+  }
+#endif
+
+#ifdef WITH_TURBOJPEG
+  // Decodes whole, then copies the wanted columns
+  bool DecodeCropCopy(const std::uint8_t* jpg, std::size_t size,
+      std::uint8_t* out, const Pixel& pixel, unsigned int crop_x,
+      unsigned int crop_width, unsigned int width, unsigned int height,
+      std::size_t step) {
+    unsigned int comps = (pixel == PIXEL_GRAY) ? 1 : 3;
+    frame.resize(width * height * comps);
+    if (!DecodeTurbo(jpg, size, frame.data(), pixel)) return false;
+    unsigned int row_bytes = crop_width * comps;
+    std::size_t row_stride = step > 0 ? step : row_bytes;
+    for (unsigned int r = 0; r < height; ++r) {
+      const std::uint8_t* src = frame.data() + (r * width + crop_x) * comps;
+      std::copy(src, src + row_bytes, out + r * row_stride);
+    }
+    return true;
+  }
+#endif
+
+  // Scratch of the cropped decoding
+  std::vector<std::uint8_t> row;
+  std::vector<std::uint8_t> frame;
+};
+
+JpegDecoder::JpegDecoder() : impl_(new Impl()) {
+}
+
+JpegDecoder::~JpegDecoder() {
+}
+
+JpegDecoder& JpegDecoder::ThreadInstance() {
+  static thread_local JpegDecoder decoder;
+  return decoder;
+}
+
+bool JpegDecoder::Decode(const std::uint8_t* jpg, std::size_t size,
+    std::uint8_t* out, const Pixel& pixel, std::size_t step) {
+#ifdef WITH_TURBOJPEG
+  if (impl_->handle != nullptr) {
+    return impl_->DecodeTurbo(jpg, size, out, pixel, step);
+  }
+#endif
+#ifdef WITH_JPEG
+  return impl_->DecodeLibjpeg(jpg, size, out, pixel, 0, 0, step);
+#else
+  UNUSED(jpg, size, out, pixel, step);
+  throw new std::runtime_error(
+      "Can't decode MJPG, as libjpeg not found.");
+#endif
+}
+
+bool JpegDecoder::DecodeCrop(const std::uint8_t* jpg, std::size_t size,
+    std::uint8_t* out, const Pixel& pixel, unsigned int x, unsigned int width,
+    unsigned int frame_width, unsigned int frame_height, std::size_t step) {
+#if defined(WITH_JPEG) && (defined(WITH_JPEG_CROP) || !defined(WITH_TURBOJPEG))
+  // Prefer libjpeg here, as TurboJPEG could not decode part columns
+  UNUSED(frame_width, frame_height);
+  return impl_->DecodeLibjpeg(jpg, size, out, pixel, x, width, step);
+#elif defined(WITH_TURBOJPEG)
+  if (impl_->handle == nullptr) return false;
+  return impl_->DecodeCropCopy(jpg, size, out, pixel, x, width, frame_width,
+      frame_height, step);
+#else
+  UNUSED(jpg, size, out, pixel, x, width, frame_width, frame_height, step);
+  throw new std::runtime_error(
+      "Can't decode MJPG, as libjpeg not found.");
+#endif
+}
+
+MYNTEYE_END_NAMESPACE
@@ -0,0 +1,69 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_DEVICE_JPEG_DECODER_H_
+#define MYNTEYE_DEVICE_JPEG_DECODER_H_
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Decodes MJPG frames, with TurboJPEG if found, otherwise libjpeg.
+ *
+ * The decompressor is kept and reused, one per thread.
+ */
+class JpegDecoder {
+ public:
+  enum Pixel {
+    PIXEL_RGB,
+    PIXEL_BGR,
+    PIXEL_GRAY,
+  };
+
+  ~JpegDecoder();
+
+  // The decoder of the calling thread
+  static JpegDecoder& ThreadInstance();
+
+  // Decodes jpg into out with rows of step bytes, 0 means packed. Returns
+  // false if failed.
+  bool Decode(const std::uint8_t* jpg, std::size_t size, std::uint8_t* out,
+      const Pixel& pixel, std::size_t step = 0);
+
+  // Decodes columns [x, x + width) into out with rows of step bytes, 0 means
+  // packed, skipping the others if libjpeg could crop. Returns false if
+  // failed.
+  bool DecodeCrop(const std::uint8_t* jpg, std::size_t size,
+      std::uint8_t* out, const Pixel& pixel, unsigned int x,
+      unsigned int width, unsigned int frame_width, unsigned int frame_height,
+      std::size_t step = 0);
+
+ private:
+  struct Impl;
+
+  JpegDecoder();
+
+  std::unique_ptr<Impl> impl_;
+
+  MYNTEYE_DISABLE_COPY(JpegDecoder)
+  MYNTEYE_DISABLE_MOVE(JpegDecoder)
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_DEVICE_JPEG_DECODER_H_
@@ -63,6 +63,23 @@ void Device::OnInit() {
 //     &color_image_size_, &depth_image_size_,
 //     &color_serial_number_, &depth_serial_number_, depth_data_type_);
 
+namespace {
+
+// Called on the capture thread, must not throw over it: nullptr to retry
+// later if the caches are exhausted by the policy.
+Image::pointer create_capture_image(const ImageType& type,
+    const ImageFormat& format, int width, int height) {
+  try {
+    return Image::Create(type, format, width, height, false);
+  } catch (const std::runtime_error* e) {
+    LOGW("Image capture dropped a frame: %s", e->what());
+    delete e;
+    return nullptr;
+  }
+}
+
+}  // namespace
+
 Image::pointer Device::GetImageColor() {
   unsigned int color_img_width  = (unsigned int)(
       stream_color_info_ptr_[color_res_index_].nWidth);
@@ -70,16 +87,14 @@ Image::pointer Device::GetImageColor() {
       stream_color_info_ptr_[color_res_index_].nHeight);
   bool is_mjpeg = stream_color_info_ptr_[color_res_index_].bFormatMJPG;
 
-  if (!color_image_buf_) {
-    color_image_buf_ = ImageColor::Create(
+  // Read into a new image of the caches each time, then hand it over as is
+  auto color = create_capture_image(ImageType::IMAGE_LEFT_COLOR,
       is_mjpeg ? ImageFormat::COLOR_MJPG : ImageFormat::COLOR_YUYV,
-      color_img_width, color_img_height, true);
-  } else {
-    color_image_buf_->ResetBuffer();
-  }
+      color_img_width, color_img_height);
+  if (!color) return nullptr;
 
   int ret = EtronDI_GetColorImage(etron_di_, &dev_sel_info_,
-      color_image_buf_->data(), &color_image_size_, &color_serial_number_, 0);
+      color->data(), &color_image_size_, &color_serial_number_, 0);
 
   if (ETronDI_OK != ret) {
     DBG_LOGI("GetImageColor: %d", ret);
@@ -96,10 +111,10 @@ Image::pointer Device::GetImageColor() {
     }
   }
 
-  color_image_buf_->set_valid_size(color_image_size_);
-  color_image_buf_->set_frame_id(color_serial_number_);
+  color->set_valid_size(color_image_size_);
+  color->set_frame_id(color_serial_number_);
 
-  return color_image_buf_;
+  return color;
 }
 
 Image::pointer Device::GetImageDepth() {
@@ -117,32 +132,31 @@ Image::pointer Device::GetImageDepth() {
       depth_img_width = depth_img_width * 2;
     }
 
-    if (!depth_image_buf_) {
+    // Raw depth to transfer, reused
+    if (!depth_buf_) {
       depth_buf_ = (unsigned char*)calloc(
           depth_img_width * depth_img_height * 2, sizeof(unsigned char));
-
-      if (dtc_ == DEPTH_IMG_COLORFUL_TRANSFER) {
-        depth_image_buf_ = ImageDepth::Create(ImageFormat::DEPTH_RGB,
-            depth_img_width, depth_img_height, true);
-      } else {  // DEPTH_IMG_GRAY_TRANSFER
-        depth_image_buf_ = ImageDepth::Create(ImageFormat::DEPTH_GRAY_24,
-            depth_img_width, depth_img_height, true);
-      }
-    } else {
-      depth_image_buf_->ResetBuffer();
     }
   } else {  // DEPTH_IMG_NON_TRANSFER
     depth_raw = true;
-    if (!depth_image_buf_) {
-      depth_image_buf_ = ImageDepth::Create(ImageFormat::DEPTH_RAW,
-          depth_img_width, depth_img_height, true);
-    } else {
-      depth_image_buf_->ResetBuffer();
-    }
   }
 
+  // Read or transfer into a new image of the caches each time, then hand it
+  // over as is
+  ImageFormat format;
+  if (depth_raw) {
+    format = ImageFormat::DEPTH_RAW;
+  } else if (dtc_ == DEPTH_IMG_COLORFUL_TRANSFER) {
+    format = ImageFormat::DEPTH_RGB;
+  } else {  // DEPTH_IMG_GRAY_TRANSFER
+    format = ImageFormat::DEPTH_GRAY_24;
+  }
+  auto depth = create_capture_image(ImageType::IMAGE_DEPTH, format,
+      depth_img_width, depth_img_height);
+  if (!depth) return nullptr;
+
   int ret = EtronDI_GetDepthImage(etron_di_, &dev_sel_info_,
-      depth_raw ? depth_image_buf_->data() : depth_buf_,
+      depth_raw ? depth->data() : depth_buf_,
       &depth_image_size_, &depth_serial_number_, depth_data_type_);
 
   if (ETronDI_OK != ret) {
@@ -160,45 +174,45 @@ Image::pointer Device::GetImageDepth() {
     }
   }
 
-  depth_image_buf_->set_frame_id(depth_serial_number_);
+  depth->set_frame_id(depth_serial_number_);
 
   if (depth_raw) {
-    return depth_image_buf_;
+    return depth;
   } else {
     if (dtc_ == DEPTH_IMG_COLORFUL_TRANSFER) {
       if (depth_data_type_ == ETronDI_DEPTH_DATA_14_BITS ||
           depth_data_type_ == ETronDI_DEPTH_DATA_14_BITS_RAW) {
         ColorPaletteGenerator::UpdateZ14DisplayImage_DIB24(
-            m_ColorPaletteZ14, depth_buf_, depth_image_buf_->data(),
+            m_ColorPaletteZ14, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       } else if (depth_data_type_ == ETronDI_DEPTH_DATA_11_BITS ||
                  depth_data_type_ == ETronDI_DEPTH_DATA_11_BITS_RAW) {
         ColorPaletteGenerator::UpdateD11DisplayImage_DIB24(
-            m_ColorPaletteD11, depth_buf_, depth_image_buf_->data(),
+            m_ColorPaletteD11, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       } else if (depth_data_type_ == ETronDI_DEPTH_DATA_8_BITS) {
         ColorPaletteGenerator::UpdateD8bitsDisplayImage_DIB24(
-            m_ColorPalette, depth_buf_, depth_image_buf_->data(),
+            m_ColorPalette, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       }
     } else {  // DEPTH_IMG_GRAY_TRANSFER
       if (depth_data_type_ == ETronDI_DEPTH_DATA_14_BITS ||
           depth_data_type_ == ETronDI_DEPTH_DATA_14_BITS_RAW) {
         ColorPaletteGenerator::UpdateZ14DisplayImage_DIB24(
-            m_GrayPaletteZ14, depth_buf_, depth_image_buf_->data(),
+            m_GrayPaletteZ14, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       } else if (depth_data_type_ == ETronDI_DEPTH_DATA_11_BITS ||
                  depth_data_type_ == ETronDI_DEPTH_DATA_11_BITS_RAW) {
         ColorPaletteGenerator::UpdateD11DisplayImage_DIB24(
-            m_GrayPaletteD11, depth_buf_, depth_image_buf_->data(),
+            m_GrayPaletteD11, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       } else if (depth_data_type_ == ETronDI_DEPTH_DATA_8_BITS) {
         ColorPaletteGenerator::UpdateD8bitsDisplayImage_DIB24(
-            m_GrayPalette, depth_buf_, depth_image_buf_->data(),
+            m_GrayPalette, depth_buf_, depth->data(),
             depth_img_width, depth_img_height);
       }
     }
-    return depth_image_buf_;
+    return depth;
   }
 }
 
@@ -34,7 +34,22 @@ OpenParams::OpenParams(const std::int32_t& dev_index)
     state_ae(true),
     state_awb(true),
     ir_intensity(0),
-    ir_depth_only(false) {
+    ir_depth_only(false),
+    convert_threads(0),
+    convert_min_band_rows(64),
+    cache_prewarm_count(0),
+    cache_max_bytes(0),
+    cache_capacity(12),
+    cache_policy(CachePolicy::CACHE_ALLOCATE),
+    cache_block_timeout_ms(1000),
+    cache_idle_timeout_ms(0),
+    cache_huge_pages(false),
+    align_image_rows(false),
+    depth_gray_near(0),
+    depth_gray_far(0),
+    capture_color_cpu(-1),
+    capture_depth_cpu(-1),
+    capture_high_priority(false) {
   DBG_LOGD(__func__);
 }
 
@@ -15,9 +15,14 @@
 
 #ifdef MYNTEYE_OS_WIN
 
+#include <chrono>
+
 #include "mynteyed/device/convertor.h"
 #include "mynteyed/util/log.h"
 
+// wait for the image callback, then return nullptr if none
+#define IMAGE_WAIT_TIMEOUT_MS 100
+
 MYNTEYE_USE_NAMESPACE
 
 namespace {
@@ -255,6 +260,19 @@ void UpdateZ14DisplayImage_DIB24(RGBQUAD* pColorPaletteZ14, BYTE* pDepthZ14,
   }
 }
 
+// Called back by the SDK or on the capture thread, must not throw over them:
+// nullptr to drop the frame if the caches are exhausted by the policy.
+Image::pointer create_callback_image(const ImageType& type,
+    const ImageFormat& format, int width, int height) {
+  try {
+    return Image::Create(type, format, width, height, false);
+  } catch (const std::runtime_error* e) {
+    LOGW("Image callback dropped a frame: %s", e->what());
+    delete e;
+    return nullptr;
+  }
+}
+
 }  // namespace
 
 void Device::OnInit() {
@@ -270,51 +288,51 @@ void Device::ImgCallback(EtronDIImageType::Value imgType, int imgId,
   Device* p = static_cast<Device*>(pParam);
 
   if (EtronDIImageType::IsImageColor(imgType)) {
-    std::lock_guard<std::mutex> _(p->color_mtx_);
-    // LOGI("Image callback color");
-    if (!p->color_image_buf_) {
-      unsigned int color_img_width  =(unsigned int)(
-          p->stream_color_info_ptr_[p->color_res_index_].nWidth);
-      unsigned int color_img_height =(unsigned int)(
-          p->stream_color_info_ptr_[p->color_res_index_].nHeight);
-
-      /*
-      if (imgType == EtronDIImageType::COLOR_RGB24) {
-        p->color_image_buf_ = ImageColor::Create(ImageFormat::COLOR_RGB,
-            color_img_width, color_img_height, true);
-      */
-      if (imgType == EtronDIImageType::COLOR_YUY2) {
-        p->color_image_buf_ = ImageColor::Create(ImageFormat::COLOR_YUYV,
-            color_img_width, color_img_height, true);
-      } else if (imgType == EtronDIImageType::COLOR_MJPG) {
-        p->color_image_buf_ = ImageColor::Create(ImageFormat::COLOR_MJPG,
-            color_img_width, color_img_height, true);
-      }
+    unsigned int color_img_width  =(unsigned int)(
+        p->stream_color_info_ptr_[p->color_res_index_].nWidth);
+    unsigned int color_img_height =(unsigned int)(
+        p->stream_color_info_ptr_[p->color_res_index_].nHeight);
+
+    ImageFormat format;
+    if (imgType == EtronDIImageType::COLOR_YUY2) {
+      format = ImageFormat::COLOR_YUYV;
+    } else if (imgType == EtronDIImageType::COLOR_MJPG) {
+      format = ImageFormat::COLOR_MJPG;
     } else {
-      p->color_image_buf_->ResetBuffer();
+      LOGE("Image callback failed. Unknown image color type.");
+      return;
     }
-    p->color_image_buf_->set_valid_size(imgSize);
-    p->color_image_buf_->set_frame_id(serialNumber);
-    std::copy(imgBuf, imgBuf + imgSize, p->color_image_buf_->data());
+    // Copy into a new image of the caches, the only copy, as the callback
+    // buffer is reused; then get hands it over as is
+    auto color = create_callback_image(ImageType::IMAGE_LEFT_COLOR, format,
+        color_img_width, color_img_height);
+    if (!color) return;
+    color->set_valid_size(imgSize);
+    color->set_frame_id(serialNumber);
+    std::copy(imgBuf, imgBuf + imgSize, color->data());
+
+    std::lock_guard<std::mutex> _(p->color_mtx_);
+    // LOGI("Image callback color");
+    p->color_image_buf_ = color;
     p->is_color_ok_ = true;
     p->color_condition_.notify_one();
   } else if (EtronDIImageType::IsImageDepth(imgType)) {
+    unsigned int depth_img_width  = (unsigned int)(
+        p->stream_depth_info_ptr_[p->depth_res_index_].nWidth);
+    unsigned int depth_img_height = (unsigned int)(
+        p->stream_depth_info_ptr_[p->depth_res_index_].nHeight);
+
+    // Copy into a new image of the caches, as color
+    auto depth = create_callback_image(ImageType::IMAGE_DEPTH,
+        ImageFormat::DEPTH_RAW, depth_img_width, depth_img_height);
+    if (!depth) return;
+    depth->set_valid_size(imgSize);
+    depth->set_frame_id(serialNumber);
+    std::copy(imgBuf, imgBuf + imgSize, depth->data());
+
     std::lock_guard<std::mutex> _(p->depth_mtx_);
     // LOGI("Image callback depth");
-    if (!p->depth_image_buf_) {
-      unsigned int depth_img_width  = (unsigned int)(
-          p->stream_depth_info_ptr_[p->depth_res_index_].nWidth);
-      unsigned int depth_img_height = (unsigned int)(
-          p->stream_depth_info_ptr_[p->depth_res_index_].nHeight);
-
-      p->depth_image_buf_ = ImageDepth::Create(ImageFormat::DEPTH_RAW,
-          depth_img_width, depth_img_height, true);
-    } else {
-      p->depth_image_buf_->ResetBuffer();
-    }
-    p->depth_image_buf_->set_valid_size(imgSize);
-    p->depth_image_buf_->set_frame_id(serialNumber);
-    std::copy(imgBuf, imgBuf + imgSize, p->depth_image_buf_->data());
+    p->depth_image_buf_ = depth;
     p->is_depth_ok_ = true;
     p->depth_condition_.notify_one();
   } else {
@@ -325,42 +343,37 @@ void Device::ImgCallback(EtronDIImageType::Value imgType, int imgId,
 Image::pointer Device::GetImageColor() {
   // LOGI("Get image color");
   std::unique_lock<std::mutex> lock(color_mtx_);
-  color_condition_.wait(lock, [this] { return is_color_ok_; });
-  is_color_ok_ = false;
-
-  if (color_image_buf_) {
-    // unsigned int color_img_width  = (unsigned int)(
-    //     stream_color_info_ptr_[color_res_index_].nWidth);
-    // unsigned int color_img_height = (unsigned int)(
-    //     stream_color_info_ptr_[color_res_index_].nHeight);
-
-    if (color_image_buf_->format() == ImageFormat::COLOR_MJPG) {  // mjpg
-      // return clone as it will be changed in imgcallback
-      return color_image_buf_->Clone();
-    } else if (color_image_buf_->format() == ImageFormat::COLOR_YUYV) {  // YUYV
-      /*
-      // clone as it will be changed in imgcallback
-      auto color = color_image_buf_->Clone();
-      // flip afer clone, because the buffer may not updated when get again
-      FLIP_UP_DOWN_C3(color->data(), color_img_width, color_img_height);
-      RGB_TO_BGR(color->data(), color_img_width, color_img_height);
-      */
-      return color_image_buf_->Clone();
-    } else {
-      LOGE("Unknown image color type.");
-    }
+  // Timeout to let the capture thread check whether stopped
+  if (!color_condition_.wait_for(lock,
+      std::chrono::milliseconds(IMAGE_WAIT_TIMEOUT_MS),
+      [this] { return is_color_ok_; })) {
+    return nullptr;
   }
+  is_color_ok_ = false;
 
-  return nullptr;
+  // Taken, the callback captures into a new one
+  auto color = std::move(color_image_buf_);
+  color_image_buf_ = nullptr;
+  return color;
 }
 
 Image::pointer Device::GetImageDepth() {
   // LOGI("Get image depth");
-  std::unique_lock<std::mutex> lock(depth_mtx_);
-  depth_condition_.wait(lock, [this] { return is_depth_ok_; });
-  is_depth_ok_ = false;
+  Image::pointer depth;
+  {
+    std::unique_lock<std::mutex> lock(depth_mtx_);
+    if (!depth_condition_.wait_for(lock,
+        std::chrono::milliseconds(IMAGE_WAIT_TIMEOUT_MS),
+        [this] { return is_depth_ok_; })) {
+      return nullptr;
+    }
+    is_depth_ok_ = false;
+    // Taken, the callback captures into a new one
+    depth = std::move(depth_image_buf_);
+    depth_image_buf_ = nullptr;
+  }
 
-  if (depth_image_buf_) {
+  if (depth) {
     // DEPTH_14BITS for ETronDI_DEPTH_DATA_14_BITS
     unsigned int depth_img_width  = (unsigned int)(
         stream_depth_info_ptr_[depth_res_index_].nWidth);
@@ -369,28 +382,28 @@ Image::pointer Device::GetImageDepth() {
 
     switch (depth_mode_) {
       case DepthMode::DEPTH_RAW:
-        // return clone as it will be changed in imgcallback
-        return depth_image_buf_->Clone();
+        return depth;
       case DepthMode::DEPTH_GRAY: {
-        static auto depth_gray_buf = ImageDepth::Create(
-            ImageFormat::DEPTH_GRAY_24,
-            depth_img_width, depth_img_height, true);
-        depth_gray_buf->ResetBuffer();
-        depth_gray_buf->set_frame_id(depth_image_buf_->frame_id());
+        auto depth_gray = create_callback_image(ImageType::IMAGE_DEPTH,
+            ImageFormat::DEPTH_GRAY_24, depth_img_width, depth_img_height);
+        if (!depth_gray) return nullptr;
+        depth_gray->set_frame_id(depth->frame_id());
+        depth_gray->set_host_timestamp(depth->host_timestamp());
         UpdateZ14DisplayImage_DIB24(gray_palette_z14_,
-            depth_image_buf_->data(), depth_gray_buf->data(),
+            depth->data(), depth_gray->data(),
             depth_img_width, depth_img_height);
-        return depth_gray_buf;
+        return depth_gray;
       } break;
       case DepthMode::DEPTH_COLORFUL: {
-        static auto depth_rgb_buf = ImageDepth::Create(ImageFormat::DEPTH_RGB,
-            depth_img_width, depth_img_height, true);
-        depth_rgb_buf->ResetBuffer();
-        depth_rgb_buf->set_frame_id(depth_image_buf_->frame_id());
+        auto depth_rgb = create_callback_image(ImageType::IMAGE_DEPTH,
+            ImageFormat::DEPTH_RGB, depth_img_width, depth_img_height);
+        if (!depth_rgb) return nullptr;
+        depth_rgb->set_frame_id(depth->frame_id());
+        depth_rgb->set_host_timestamp(depth->host_timestamp());
         UpdateZ14DisplayImage_DIB24(color_palette_z14_,
-            depth_image_buf_->data(), depth_rgb_buf->data(),
+            depth->data(), depth_rgb->data(),
             depth_img_width, depth_img_height);
-        return depth_rgb_buf;
+        return depth_rgb;
       } break;
     }
   }
@@ -19,6 +19,7 @@
 #include <utility>
 
 #include "mynteyed/data/channels.h"
+#include "mynteyed/device/convert_engine.h"
 #include "mynteyed/device/device.h"
 #include "mynteyed/internal/image_utils.h"
 #include "mynteyed/internal/motions.h"
@@ -28,6 +29,7 @@
 #define IMG_INFO_ASYNC_MAX_SIZE 120  // 60fps, 2s
 #define STREAM_ASYNC_MAX_SIZE 1  // latest
 #define MOTION_ASYNC_MAX_SIZE 800  // 400hz, 2s
+#define FRAMESET_ASYNC_MAX_SIZE 1  // latest
 
 MYNTEYE_USE_NAMESPACE
 
@@ -67,6 +69,10 @@ ErrorCode CameraPrivate::Open(const OpenParams& params) {
     return ErrorCode::SUCCESS;
   }
 
+  auto&& engine = ConvertEngine::Instance();
+  engine.SetThreads(params.convert_threads);
+  engine.SetMinBandRows(params.convert_min_band_rows);
+
   bool ok = device_->Open(params);
   if (!ok) {
     return ErrorCode::ERROR_FAILURE;
@@ -289,6 +295,27 @@ std::vector<StreamData> CameraPrivate::GetStreamDatas(const ImageType& type) {
   return streams_->GetStreamDatas(type);
 }
 
+void CameraPrivate::SetFrameSetOptions(const FrameSetOptions& options) {
+  streams_->SetFrameSetOptions(options);
+}
+
+FrameSet CameraPrivate::GetFrameSet() {
+  return streams_->GetFrameSet();
+}
+
+StreamLatency CameraPrivate::GetStreamLatency(const ImageType& type) const {
+  return streams_->GetStreamLatency(type);
+}
+
+StreamSyncStats CameraPrivate::GetStreamSyncStats(
+    const ImageType& type) const {
+  return streams_->GetStreamSyncStats(type);
+}
+
+MotionChannelStats CameraPrivate::GetMotionChannelStats() const {
+  return channels_->GetStats();
+}
+
 bool CameraPrivate::IsMotionDatasSupported() const {
   return channels_->IsAvaliable();
 }
@@ -311,10 +338,75 @@ bool CameraPrivate::IsMotionDatasEnabled() const {
   return motions_->IsMotionDatasEnabled();
 }
 
+void CameraPrivate::EnableMotionPairing(std::uint32_t rate) {
+  motions_->EnableMotionPairing(rate);
+}
+
+void CameraPrivate::DisableMotionPairing() {
+  motions_->DisableMotionPairing();
+}
+
 std::vector<MotionData> CameraPrivate::GetMotionDatas() {
   return std::move(motions_->GetMotionDatas());
 }
 
+std::vector<MotionData> CameraPrivate::GetMotionDatas(std::uint64_t from,
+    std::uint64_t to) {
+  return motions_->GetMotionDatas(from, to);
+}
+
+std::size_t CameraPrivate::GetMotionDatas(std::uint64_t from,
+    std::uint64_t to, std::vector<ImuData>* datas) {
+  return motions_->GetMotionDatas(from, to, datas);
+}
+
+void CameraPrivate::EnableStreamMotionDatas() {
+  if (!IsMotionDatasEnabled() || !IsImageInfoSynced()) {
+    LOGW("Warning: Please enable motion datas and sync image infos, or "
+        "stream datas will not have motion datas.");
+  }
+  streams_->SetMotionDatasGetter(std::bind(
+      static_cast<Motions::datas_t (Motions::*)(std::uint64_t, std::uint64_t)>(
+          &Motions::GetMotionDatas),
+      motions_, std::placeholders::_1, std::placeholders::_2));
+}
+
+void CameraPrivate::DisableStreamMotionDatas() {
+  streams_->SetMotionDatasGetter(nullptr);
+}
+
+void CameraPrivate::EnablePreintegration() {
+  if (!IsMotionDatasEnabled() || !IsImageInfoSynced()) {
+    LOGW("Warning: Please enable motion datas and sync image infos, or "
+        "stream datas will not have preintegration.");
+  }
+  motions_->EnablePreintegration();
+  streams_->SetPreintegrationGetter(std::bind(
+      static_cast<std::shared_ptr<ImuPreintegration> (Motions::*)(
+          std::uint64_t)>(&Motions::GetPreintegration),
+      motions_, std::placeholders::_1));
+}
+
+void CameraPrivate::DisablePreintegration() {
+  streams_->SetPreintegrationGetter(nullptr);
+  motions_->DisablePreintegration();
+}
+
+void CameraPrivate::SetPreintegrationBias(const double (&accel)[3],
+    const double (&gyro)[3]) {
+  motions_->SetPreintegrationBias(accel, gyro);
+}
+
+bool CameraPrivate::GetPreintegration(std::uint64_t from, std::uint64_t to,
+    ImuPreintegration* result) {
+  return motions_->GetPreintegration(from, to, result);
+}
+
+std::int64_t CameraPrivate::GetHostTimestamp(
+    std::uint64_t device_timestamp) const {
+  return channels_->GetClockSync()->ToHost(device_timestamp);
+}
+
 void CameraPrivate::SetImgInfoCallback(img_info_callback_t callback,
     bool async) {
   if (async) {
@@ -348,6 +440,22 @@ void CameraPrivate::SetMotionCallback(motion_callback_t callback, bool async) {
   }
 }
 
+void CameraPrivate::SetMotionBatchCallback(
+    motion_batch_callback_t callback) {
+  motions_->SetMotionBatchCallback(callback);
+}
+
+void CameraPrivate::SetFrameSetCallback(frameset_callback_t callback,
+    bool async) {
+  if (async) {
+    auto frameset_async_callback =
+        AsyncCallback<FrameSet>::Create(callback, FRAMESET_ASYNC_MAX_SIZE);
+    streams_->SetFrameSetCallback((*frameset_async_callback)());
+  } else {
+    streams_->SetFrameSetCallback(callback);
+  }
+}
+
 void CameraPrivate::Close() {
   if (!IsOpened()) return;
   StopDataTracking();
@@ -431,13 +539,19 @@ bool CameraPrivate::StartDataTracking() {
   }
 
   if (motions_->IsMotionDatasEnabled()) {
-    channels_->SetImuDataCallback(std::bind(&Motions::OnImuDataCallback,
+    channels_->SetImuDatasCallback(std::bind(&Motions::OnImuDatasCallback,
         motions_, std::placeholders::_1));
   }
 
   if (streams_->IsImageInfoEnabled()) {
-    channels_->SetImgInfoCallback(std::bind(&Streams::OnImageInfoCallback,
-          streams_, std::placeholders::_1));
+    auto&& streams = streams_;
+    auto&& motions = motions_;
+    // motions cut the preintegration at the image timestamps
+    channels_->SetImgInfoCallback([streams, motions](
+        const ImgInfoPacket& packet) {
+      streams->OnImageInfoCallback(packet);
+      motions->OnImageInfoCallback(packet);
+    });
   }
 
   if (channels_->IsHidTracking()) return true;
@@ -41,6 +41,9 @@ class MYNTEYE_API CameraPrivate {
         std::function<void(const std::shared_ptr<ImgInfo>& info)>;
   using stream_callback_t = std::function<void(const StreamData& data)>;
   using motion_callback_t = std::function<void(const MotionData& data)>;
+  using motion_batch_callback_t =
+      std::function<void(const ImuData* datas, std::size_t count)>;
+  using frameset_callback_t = std::function<void(const FrameSet& frameset)>;
 
   CameraPrivate();
   ~CameraPrivate();
@@ -122,6 +125,15 @@ class MYNTEYE_API CameraPrivate {
   StreamData GetStreamData(const ImageType& type);
   /** Get cached stream datas */
   std::vector<StreamData> GetStreamDatas(const ImageType& type);
+  /** Set the options to assemble frame sets */
+  void SetFrameSetOptions(const FrameSetOptions& options);
+  /** Get latest frame set */
+  FrameSet GetFrameSet();
+  /** Get the latency of stream data of certain image type */
+  StreamLatency GetStreamLatency(const ImageType& type) const;
+  /** Get the stats of syncing stream data of certain image type with infos */
+  StreamSyncStats GetStreamSyncStats(const ImageType& type) const;
+  MotionChannelStats GetMotionChannelStats() const;
 
   /** Whethor motion datas supported or not */
   bool IsMotionDatasSupported() const;
@@ -139,8 +151,28 @@ class MYNTEYE_API CameraPrivate {
   /** Whethor motion datas enabled or not */
   bool IsMotionDatasEnabled() const;
 
+  /** Enable motion pairing, at the rate in hz, or of the gyro if 0 */
+  void EnableMotionPairing(std::uint32_t rate);
+  /** Disable motion pairing. */
+  void DisableMotionPairing();
+
   /** Get cached motion datas. Besides, you can also get them from callback */
   std::vector<MotionData> GetMotionDatas();
+  std::vector<MotionData> GetMotionDatas(std::uint64_t from, std::uint64_t to);
+  std::size_t GetMotionDatas(std::uint64_t from, std::uint64_t to,
+      std::vector<ImuData>* datas);
+
+  void EnableStreamMotionDatas();
+  void DisableStreamMotionDatas();
+
+  void EnablePreintegration();
+  void DisablePreintegration();
+  void SetPreintegrationBias(const double (&accel)[3],
+      const double (&gyro)[3]);
+  bool GetPreintegration(std::uint64_t from, std::uint64_t to,
+      ImuPreintegration* result);
+
+  std::int64_t GetHostTimestamp(std::uint64_t device_timestamp) const;
 
   /** Set image info callback. */
   void SetImgInfoCallback(img_info_callback_t callback, bool async);
@@ -151,6 +183,10 @@ class MYNTEYE_API CameraPrivate {
 
   /** Set motion data callback. */
   void SetMotionCallback(motion_callback_t callback, bool async);
+  void SetMotionBatchCallback(motion_batch_callback_t callback);
+
+  /** Set frame set callback. */
+  void SetFrameSetCallback(frameset_callback_t callback, bool async);
 
   /** Close the camera */
   void Close();
@@ -0,0 +1,209 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/internal/frame_sets.h"
+
+#include <algorithm>
+#include <utility>
+
+// pending sets at most, the oldest flushed over it
+#define FRAMESET_PENDING_MAX_SIZE 8
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+bool is_color(const ImageType& type) {
+  return type == ImageType::IMAGE_LEFT_COLOR
+      || type == ImageType::IMAGE_RIGHT_COLOR;
+}
+
+// Distance of 16-bit frame ids, across wrapping around
+std::uint16_t frame_id_distance(std::uint16_t a, std::uint16_t b) {
+  std::uint16_t d = a - b;
+  return std::min<std::uint16_t>(d, -d);
+}
+
+}  // namespace
+
+FrameSets::FrameSets()
+  : callback_(nullptr), tickets_(0), delivered_(0), queue_(1) {
+}
+
+FrameSets::~FrameSets() {
+}
+
+void FrameSets::SetOptions(const FrameSetOptions& options) {
+  std::lock_guard<std::mutex> _(mutex_);
+  options_ = options;
+}
+
+FrameSetOptions FrameSets::GetOptions() const {
+  std::lock_guard<std::mutex> _(mutex_);
+  return options_;
+}
+
+void FrameSets::SetCallback(frameset_callback_t callback) {
+  std::lock_guard<std::mutex> _(mutex_);
+  callback_ = callback;
+}
+
+void FrameSets::Put(const ImageType& type, const StreamData& data,
+    const std::set<ImageType>& required) {
+  if (!data.img) return;
+  std::uint16_t frame_id = data.img->frame_id();
+  auto now = clock::now();
+  std::vector<FrameSet> ready;
+  std::uint64_t ticket = 0;
+  frameset_callback_t callback;
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    // Flush the timeout ones, always the oldest at front
+    auto&& timeout = std::chrono::milliseconds(options_.timeout_ms);
+    std::size_t n = 0;
+    while (n < pendings_.size() && now - pendings_[n].time > timeout) ++n;
+    Flush(n, &ready);
+
+    std::size_t i = 0;
+    while (i < pendings_.size() && !Accepts(pendings_[i], type, frame_id)) {
+      ++i;
+    }
+    if (i == pendings_.size()) {
+      if (pendings_.size() == FRAMESET_PENDING_MAX_SIZE) {
+        Flush(1, &ready);
+        --i;
+      }
+      Pending pending;
+      pending.has_color = pending.has_depth = false;
+      pending.color_id = pending.depth_id = 0;
+      pending.time = now;
+      pendings_.push_back(std::move(pending));
+    }
+
+    auto&& pending = pendings_[i];
+    auto&& frameset = pending.frameset;
+    switch (type) {
+      case ImageType::IMAGE_LEFT_COLOR: frameset.left = data; break;
+      case ImageType::IMAGE_RIGHT_COLOR: frameset.right = data; break;
+      case ImageType::IMAGE_DEPTH: frameset.depth = data; break;
+      default: break;
+    }
+    if (is_color(type)) {
+      pending.has_color = true;
+      pending.color_id = frame_id;
+      frameset.frame_id = data.img->frame_id();
+    } else {
+      pending.has_depth = true;
+      pending.depth_id = frame_id;
+      if (!pending.has_color) frameset.frame_id = data.img->frame_id();
+    }
+
+    if (IsComplete(pending, required)) {
+      frameset.complete = true;
+      // The older ones would be out of order after it
+      Flush(i, &ready);
+      ready.push_back(std::move(pendings_.front().frameset));
+      pendings_.pop_front();
+    }
+    if (ready.empty()) return;
+    // Callbacks run outside the lock, in the order the sets are ready here
+    ticket = tickets_++;
+    callback = callback_;
+  }
+  Deliver(ready, ticket, callback);
+}
+
+FrameSet FrameSets::Get() {
+  return queue_.Take();
+}
+
+void FrameSets::Clear() {
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    pendings_.clear();
+  }
+  queue_.Clear();
+}
+
+bool FrameSets::Accepts(const Pending& pending, const ImageType& type,
+    std::uint16_t frame_id) const {
+  auto&& frameset = pending.frameset;
+  switch (type) {
+    case ImageType::IMAGE_LEFT_COLOR:
+      if (frameset.left.img) return false;
+      break;
+    case ImageType::IMAGE_RIGHT_COLOR:
+      if (frameset.right.img) return false;
+      break;
+    case ImageType::IMAGE_DEPTH:
+      if (frameset.depth.img) return false;
+      break;
+    default:
+      return false;
+  }
+  if (is_color(type)) {
+    // left and right of the same color
+    if (pending.has_color) return pending.color_id == frame_id;
+    return frame_id_distance(pending.depth_id, frame_id)
+        <= options_.frame_id_tolerance;
+  }
+  return !pending.has_color || frame_id_distance(pending.color_id, frame_id)
+      <= options_.frame_id_tolerance;
+}
+
+bool FrameSets::IsComplete(const Pending& pending,
+    const std::set<ImageType>& required) const {
+  auto&& frameset = pending.frameset;
+  for (auto&& type : required) {
+    switch (type) {
+      case ImageType::IMAGE_LEFT_COLOR:
+        if (!frameset.left.img) return false;
+        break;
+      case ImageType::IMAGE_RIGHT_COLOR:
+        if (!frameset.right.img) return false;
+        break;
+      case ImageType::IMAGE_DEPTH:
+        if (!frameset.depth.img) return false;
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+void FrameSets::Flush(std::size_t end, std::vector<FrameSet>* ready) {
+  for (std::size_t i = 0; i < end; ++i) {
+    if (!options_.drop_incomplete) {
+      ready->push_back(std::move(pendings_.front().frameset));
+    }
+    pendings_.pop_front();
+  }
+}
+
+void FrameSets::Deliver(const std::vector<FrameSet>& ready,
+    std::uint64_t ticket, const frameset_callback_t& callback) {
+  std::unique_lock<std::mutex> lock(delivery_mutex_);
+  delivery_condition_.wait(lock, [this, ticket]() {
+    return delivered_ == ticket;
+  });
+  for (auto&& frameset : ready) {
+    queue_.Put(frameset);
+    if (callback) callback(frameset);
+  }
+  ++delivered_;
+  lock.unlock();
+  delivery_condition_.notify_all();
+}
+
+MYNTEYE_END_NAMESPACE
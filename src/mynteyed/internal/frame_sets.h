@@ -0,0 +1,103 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_INTERNAL_FRAME_SETS_H_
+#define MYNTEYE_INTERNAL_FRAME_SETS_H_
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "mynteyed/internal/blocking_queue.h"
+#include "mynteyed/types.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Assembles the stream datas of one capture instant into frame sets.
+ *
+ * Left and right share the color frame id, depth joins the set whose color
+ * frame id is within the tolerance. A set is delivered once it has all the
+ * required, or the timeout passed; the older pending ones are flushed before
+ * a newer one, so sets are always delivered in order.
+ */
+class FrameSets {
+ public:
+  using clock = std::chrono::steady_clock;
+  using frameset_callback_t = std::function<void(const FrameSet& frameset)>;
+
+  FrameSets();
+  ~FrameSets();
+
+  void SetOptions(const FrameSetOptions& options);
+  FrameSetOptions GetOptions() const;
+
+  void SetCallback(frameset_callback_t callback);
+
+  // Puts the stream data, required are the image types a set needs
+  void Put(const ImageType& type, const StreamData& data,
+      const std::set<ImageType>& required);
+
+  // Latest frame set, blocks until one if none
+  FrameSet Get();
+
+  void Clear();
+
+ private:
+  struct Pending {
+    FrameSet frameset;
+    bool has_color;
+    std::uint16_t color_id;
+    bool has_depth;
+    std::uint16_t depth_id;
+    clock::time_point time;
+  };
+
+  bool Accepts(const Pending& pending, const ImageType& type,
+      std::uint16_t frame_id) const;
+  bool IsComplete(const Pending& pending,
+      const std::set<ImageType>& required) const;
+  // Moves the pending sets before end out, to be delivered if not dropped
+  void Flush(std::size_t end, std::vector<FrameSet>* ready);
+  // Delivers in the turn of the ticket, taken along with the ready ones
+  void Deliver(const std::vector<FrameSet>& ready, std::uint64_t ticket,
+      const frameset_callback_t& callback);
+
+  FrameSetOptions options_;
+  frameset_callback_t callback_;
+
+  std::deque<Pending> pendings_;
+  std::uint64_t tickets_;
+  mutable std::mutex mutex_;
+
+  // Serializes the deliveries of the puts in the order of their tickets
+  std::uint64_t delivered_;
+  std::mutex delivery_mutex_;
+  std::condition_variable delivery_condition_;
+
+  // The latest for Get()
+  BlockingQueue<FrameSet> queue_;
+
+  MYNTEYE_DISABLE_COPY(FrameSets)
+  MYNTEYE_DISABLE_MOVE(FrameSets)
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_INTERNAL_FRAME_SETS_H_
@@ -0,0 +1,263 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_INTERNAL_FRAME_SYNC_H_
+#define MYNTEYE_INTERNAL_FRAME_SYNC_H_
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Matches streams to infos of the same frame id, in O(1) each.
+ *
+ * The pending ones are kept in a ring indexed by frame id modulo the window,
+ * so ids wrapping around 65535 to 0 stay consecutive. One pending is dropped
+ * as an orphan if another id of its slot comes, i.e. window ids later, if
+ * unmatched over the max age, or if more streams are pending than the max.
+ */
+template <typename S, typename I>
+class FrameSync {
+ public:
+  using clock = std::chrono::steady_clock;
+  using frame_id_t = std::uint16_t;
+
+  struct Stats {
+    std::uint64_t matched = 0;
+    std::uint64_t stream_orphans = 0;
+    std::uint64_t info_orphans = 0;
+    // time the first of a stream and its info waits for the other
+    std::uint64_t latency_sum_us = 0;
+    std::uint64_t latency_max_us = 0;
+  };
+
+  /**
+   * window is rounded up to a power of 2, at most 65536.
+   */
+  FrameSync(std::size_t window, clock::duration max_age,
+      std::size_t max_streams);
+
+  // Streams pending at most, the oldest dropped over it. Keeps images of
+  // frames whose infos are lost from piling up.
+  void SetMaxStreams(std::size_t max_streams);
+
+  // Returns true with its info taken if matched; otherwise keeps it pending
+  bool PutStream(frame_id_t frame_id, S stream, I* info);
+  // Returns true with its stream taken if matched; otherwise keeps it pending
+  bool PutInfo(frame_id_t frame_id, I info, S* stream);
+
+  // Drops all pending, not counted as orphans
+  void Clear();
+
+  Stats GetStats() const;
+  void ResetStats();
+
+ private:
+  // Pending a stream or an info, never both as matched at once
+  struct Slot {
+    bool has_stream = false;
+    bool has_info = false;
+    frame_id_t frame_id = 0;
+    S stream;
+    I info;
+    clock::time_point time;
+    std::uint64_t stream_seq = 0;
+  };
+
+  Slot& At(frame_id_t frame_id) {
+    return slots_[frame_id & mask_];
+  }
+
+  void Evict(Slot* slot);
+  void Matched(Slot* slot, const clock::time_point& now);
+  // Ages out a few slots each put, round robin, so constant cost
+  void Sweep(const clock::time_point& now);
+  void LimitStreams();
+
+  std::vector<Slot> slots_;
+  std::size_t mask_;
+  clock::duration max_age_;
+  std::size_t max_streams_;
+  std::size_t sweep_cursor_;
+
+  // frame id and seq of the streams in arrival order, ones not pending any
+  // more are skipped when reaching the front
+  std::deque<std::pair<frame_id_t, std::uint64_t>> stream_order_;
+  std::size_t streams_pending_;
+  std::uint64_t stream_seq_;
+
+  Stats stats_;
+
+  mutable std::mutex mutex_;
+};
+
+#define FRAME_SYNC_SWEEP_SLOTS 2
+
+template <typename S, typename I>
+FrameSync<S, I>::FrameSync(std::size_t window, clock::duration max_age,
+    std::size_t max_streams)
+  : max_age_(max_age), max_streams_(max_streams), sweep_cursor_(0),
+    streams_pending_(0), stream_seq_(0) {
+  std::size_t size = 1;
+  while (size < window && size < 65536) size <<= 1;
+  slots_.resize(size);
+  mask_ = size - 1;
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::SetMaxStreams(std::size_t max_streams) {
+  std::lock_guard<std::mutex> _(mutex_);
+  max_streams_ = max_streams;
+  LimitStreams();
+}
+
+template <typename S, typename I>
+bool FrameSync<S, I>::PutStream(frame_id_t frame_id, S stream, I* info) {
+  std::lock_guard<std::mutex> _(mutex_);
+  auto now = clock::now();
+  Sweep(now);
+  auto&& slot = At(frame_id);
+  if (slot.frame_id != frame_id || slot.has_stream) {
+    // window ids ago, or the same id again
+    Evict(&slot);
+  }
+  if (slot.has_info) {
+    *info = std::move(slot.info);
+    Matched(&slot, now);
+    return true;
+  }
+  slot.has_stream = true;
+  slot.frame_id = frame_id;
+  slot.stream = std::move(stream);
+  slot.time = now;
+  slot.stream_seq = ++stream_seq_;
+  ++streams_pending_;
+  stream_order_.emplace_back(frame_id, stream_seq_);
+  LimitStreams();
+  return false;
+}
+
+template <typename S, typename I>
+bool FrameSync<S, I>::PutInfo(frame_id_t frame_id, I info, S* stream) {
+  std::lock_guard<std::mutex> _(mutex_);
+  auto now = clock::now();
+  Sweep(now);
+  auto&& slot = At(frame_id);
+  if (slot.frame_id != frame_id || slot.has_info) {
+    Evict(&slot);
+  }
+  if (slot.has_stream) {
+    *stream = std::move(slot.stream);
+    slot.has_stream = false;
+    --streams_pending_;
+    Matched(&slot, now);
+    return true;
+  }
+  slot.has_info = true;
+  slot.frame_id = frame_id;
+  slot.info = std::move(info);
+  slot.time = now;
+  return false;
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::Clear() {
+  std::lock_guard<std::mutex> _(mutex_);
+  for (auto&& slot : slots_) {
+    slot.has_stream = slot.has_info = false;
+    slot.stream = S();
+    slot.info = I();
+  }
+  stream_order_.clear();
+  streams_pending_ = 0;
+}
+
+template <typename S, typename I>
+typename FrameSync<S, I>::Stats FrameSync<S, I>::GetStats() const {
+  std::lock_guard<std::mutex> _(mutex_);
+  return stats_;
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::ResetStats() {
+  std::lock_guard<std::mutex> _(mutex_);
+  stats_ = Stats();
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::Evict(Slot* slot) {
+  if (slot->has_stream) {
+    ++stats_.stream_orphans;
+    --streams_pending_;
+    slot->has_stream = false;
+    slot->stream = S();
+  }
+  if (slot->has_info) {
+    ++stats_.info_orphans;
+    slot->has_info = false;
+    slot->info = I();
+  }
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::Matched(Slot* slot, const clock::time_point& now) {
+  slot->has_stream = slot->has_info = false;
+  slot->stream = S();
+  slot->info = I();
+  std::uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          now - slot->time).count();
+  ++stats_.matched;
+  stats_.latency_sum_us += latency_us;
+  if (latency_us > stats_.latency_max_us) {
+    stats_.latency_max_us = latency_us;
+  }
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::Sweep(const clock::time_point& now) {
+  for (int i = 0; i < FRAME_SYNC_SWEEP_SLOTS; ++i) {
+    auto&& slot = slots_[sweep_cursor_];
+    sweep_cursor_ = (sweep_cursor_ + 1) & mask_;
+    if ((slot.has_stream || slot.has_info) && now - slot.time > max_age_) {
+      Evict(&slot);
+    }
+  }
+}
+
+template <typename S, typename I>
+void FrameSync<S, I>::LimitStreams() {
+  while (!stream_order_.empty()) {
+    auto&& front = stream_order_.front();
+    auto&& slot = At(front.first);
+    bool pending = slot.has_stream && slot.frame_id == front.first
+        && slot.stream_seq == front.second;
+    if (pending) {
+      if (streams_pending_ <= max_streams_) break;
+      Evict(&slot);
+    }
+    stream_order_.pop_front();
+  }
+}
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_INTERNAL_FRAME_SYNC_H_
@@ -45,6 +45,7 @@ Image::pointer split_left_color(Image::pointer color) {
   auto image = ImageColor::Create(ImageType::IMAGE_LEFT_COLOR,
       color->format(), color->width() / 2, color->height(), false);
   image->set_frame_id(color->frame_id());
+  image->set_host_timestamp(color->host_timestamp());
   _copy_left_yuyv(color->data(), image->data(),
       color->width(), color->height());
   return image;
@@ -57,6 +58,7 @@ Image::pointer split_right_color(Image::pointer color) {
   auto image = ImageColor::Create(ImageType::IMAGE_RIGHT_COLOR,
       color->format(), color->width() / 2, color->height(), false);
   image->set_frame_id(color->frame_id());
+  image->set_host_timestamp(color->host_timestamp());
   _copy_right_yuyv(color->data(), image->data(),
       color->width(), color->height());
   return image;
@@ -0,0 +1,159 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/internal/motion_pairing.h"
+
+#include <algorithm>
+
+// samples kept each sensor, the oldest dropped if the other stalls
+#define MOTION_PAIRING_MAX_SIZE 64
+// timestamps in 0.01ms
+#define MOTION_TIMESTAMP_RATE 100000
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+const double* values_of(const ImuData& imu) {
+  return imu.flag == MYNTEYE_IMU_ACCEL ? imu.accel : imu.gyro;
+}
+
+}  // namespace
+
+MotionPairing::MotionPairing(std::uint32_t rate)
+  : rate_(rate),
+    accels_(MOTION_PAIRING_MAX_SIZE),
+    gyros_(MOTION_PAIRING_MAX_SIZE),
+    has_next_(false),
+    next_time_(0),
+    next_index_(0),
+    has_paired_(false),
+    last_time_(0) {
+}
+
+void MotionPairing::Put(const ImuData& imu, std::vector<ImuData>* pairs) {
+  RingBuffer<ImuData>* samples;
+  if (imu.flag == MYNTEYE_IMU_ACCEL) {
+    samples = &accels_;
+  } else if (imu.flag == MYNTEYE_IMU_GYRO) {
+    samples = &gyros_;
+  } else {
+    return;
+  }
+  if (!samples->empty()) {
+    auto&& last_time = samples->back().timestamp;
+    if (imu.timestamp < last_time) {
+      // the timestamps restart if the device reset
+      Reset();
+    } else if (imu.timestamp == last_time) {
+      return;
+    }
+  }
+  if (samples->size() == samples->capacity()) {
+    samples->pop_front();
+  }
+  samples->push_back(imu);
+
+  if (accels_.empty() || gyros_.empty()) return;
+  auto&& end_time = std::min(accels_.back().timestamp,
+      gyros_.back().timestamp);
+  while (UpdateNextTime() && next_time_ <= end_time) {
+    // keep the last one at or before the time, to interpolate from
+    while (accels_.size() > 1 && accels_[1].timestamp <= next_time_) {
+      accels_.pop_front();
+    }
+    while (gyros_.size() > 1 && gyros_[1].timestamp <= next_time_) {
+      gyros_.pop_front();
+    }
+
+    pairs->emplace_back();
+    auto&& pair = pairs->back();
+    pair.flag = MYNTEYE_IMU_ACCEL_GYRO;
+    pair.timestamp = next_time_;
+    double accel_temperature;
+    std::int64_t accel_host_timestamp;
+    Interpolate(accels_, next_time_, pair.accel, &accel_temperature,
+        &accel_host_timestamp);
+    Interpolate(gyros_, next_time_, pair.gyro, &pair.temperature,
+        &pair.host_timestamp);
+
+    has_next_ = false;
+    has_paired_ = true;
+    last_time_ = next_time_;
+    ++next_index_;
+  }
+}
+
+void MotionPairing::Reset() {
+  accels_.clear();
+  gyros_.clear();
+  has_next_ = false;
+  next_time_ = 0;
+  next_index_ = 0;
+  has_paired_ = false;
+  last_time_ = 0;
+}
+
+void MotionPairing::Interpolate(const RingBuffer<ImuData>& samples,
+    std::uint64_t time, double* values, double* temperature,
+    std::int64_t* host_timestamp) {
+  auto&& from = samples[0];
+  auto&& from_values = values_of(from);
+  if (samples.size() == 1 || time <= from.timestamp) {
+    std::copy(from_values, from_values + 3, values);
+    *temperature = from.temperature;
+    *host_timestamp = from.host_timestamp;
+    return;
+  }
+  auto&& to = samples[1];
+  auto&& to_values = values_of(to);
+  double ratio = static_cast<double>(time - from.timestamp)
+      / (to.timestamp - from.timestamp);
+  for (int i = 0; i < 3; i++) {
+    values[i] = from_values[i] + (to_values[i] - from_values[i]) * ratio;
+  }
+  *temperature = from.temperature
+      + (to.temperature - from.temperature) * ratio;
+  *host_timestamp = from.host_timestamp + static_cast<std::int64_t>(
+      (to.host_timestamp - from.host_timestamp) * ratio);
+}
+
+bool MotionPairing::UpdateNextTime() {
+  if (has_next_) return true;
+  // not before the samples kept, as dropped if one stalled
+  auto&& start_time = std::max(accels_.front().timestamp,
+      gyros_.front().timestamp);
+  if (rate_ == 0) {
+    // the next gyro
+    for (std::size_t i = 0; i < gyros_.size(); i++) {
+      auto&& time = gyros_[i].timestamp;
+      if (time >= start_time && (!has_paired_ || time > last_time_)) {
+        next_time_ = time;
+        has_next_ = true;
+        break;
+      }
+    }
+    return has_next_;
+  }
+  if (!has_paired_ || next_index_ * MOTION_TIMESTAMP_RATE / rate_
+      < start_time) {
+    // ceil
+    next_index_ = (start_time * rate_ + MOTION_TIMESTAMP_RATE - 1)
+        / MOTION_TIMESTAMP_RATE;
+  }
+  next_time_ = next_index_ * MOTION_TIMESTAMP_RATE / rate_;
+  has_next_ = true;
+  return true;
+}
+
+MYNTEYE_END_NAMESPACE
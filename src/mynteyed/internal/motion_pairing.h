@@ -0,0 +1,69 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_INTERNAL_MOTION_PAIRING_H_
+#define MYNTEYE_INTERNAL_MOTION_PAIRING_H_
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mynteyed/internal/ring_buffer.h"
+#include "mynteyed/types.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Pairs accel and gyro into 6-DoF samples on a common timeline, each
+ * linearly interpolated at the time.
+ *
+ * The timeline is of the gyro samples if the rate is 0, otherwise of the
+ * rate from timestamp 0. A time is paired once both sensors have samples at
+ * or after it, in O(1) amortized each sample, without allocation.
+ */
+class MotionPairing {
+ public:
+  explicit MotionPairing(std::uint32_t rate = 0);
+
+  std::uint32_t rate() const { return rate_; }
+
+  // Appends the paired ones to pairs
+  void Put(const ImuData& imu, std::vector<ImuData>* pairs);
+
+  void Reset();
+
+ private:
+  // Interpolates the sensor at time, clamped to the samples kept
+  static void Interpolate(const RingBuffer<ImuData>& samples,
+      std::uint64_t time, double* values, double* temperature,
+      std::int64_t* host_timestamp);
+
+  // false if not known yet
+  bool UpdateNextTime();
+
+  std::uint32_t rate_;
+
+  RingBuffer<ImuData> accels_;
+  RingBuffer<ImuData> gyros_;
+
+  bool has_next_;
+  std::uint64_t next_time_;
+  // index of the next time on the timeline of the rate
+  std::uint64_t next_index_;
+  bool has_paired_;
+  std::uint64_t last_time_;
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_INTERNAL_MOTION_PAIRING_H_
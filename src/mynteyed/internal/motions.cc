@@ -13,24 +13,37 @@
 // limitations under the License.
 #include "mynteyed/internal/motions.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "mynteyed/util/log.h"
 
+// recent motion datas kept to get by the timestamps
+#define MOTION_HISTORY_MAX_SIZE 4000  // 400hz, 10s
+// imu datas of one hid read reserved, grows if more
+#define MOTION_BATCH_MAX_SIZE 64
+// preintegrations kept to get by the image timestamps
+#define PREINTEGRATION_MAX_SIZE 64  // 60fps, 1s
+// image timestamps pending to cut at, the oldest dropped if imu stalls
+#define PREINTEGRATION_CUTS_MAX_SIZE 16
+
 MYNTEYE_USE_NAMESPACE
 
-namespace {
+struct Motions::Calibration {
+  struct Transform {
+    bool temp_drift;
+    // drift = slope * temperature + constant
+    double drift_constant[3];
+    double drift_slope[3];
+    bool assembly;
+    // scale * assembly
+    double matrix[3][3];
+  };
+  Transform accel;
+  Transform gyro;
+};
 
-void matrix_3x1(const double (*src1)[3], const double (*src2)[1],
-    double (*dst)[1]) {
-  for (int i = 0; i < 3; i++) {
-    for (int j = 0; j < 1; j++) {
-      for (int k = 0; k < 3; k++) {
-        dst[i][j] += src1[i][k] * src2[k][j];
-      }
-    }
-  }
-}
+namespace {
 
 void matrix_3x3(const double (*src1)[3], const double (*src2)[3],
     double (*dst)[3]) {
@@ -50,8 +63,21 @@ Motions::Motions()
     proc_mode_(static_cast<const std::int32_t>(ProcessMode::PROC_NONE)),
     is_motion_datas_enabled_(false),
     motion_datas_max_size_(1000),
+    motion_datas_(motion_datas_max_size_),
+    motion_history_(MOTION_HISTORY_MAX_SIZE),
     motion_callback_(nullptr),
-    motion_count_(0) {
+    motion_count_(0),
+    is_motion_pairing_enabled_(false),
+    motion_pairing_rate_(0),
+    is_preintegration_enabled_(false),
+    preintegration_params_(std::make_shared<PreintegrationParams>()),
+    preintegrations_(PREINTEGRATION_MAX_SIZE),
+    motion_pairing_(nullptr),
+    preintegration_params_applied_(nullptr),
+    preintegration_cuts_(PREINTEGRATION_CUTS_MAX_SIZE) {
+  motion_batch_.reserve(MOTION_BATCH_MAX_SIZE);
+  motion_pairs_.reserve(MOTION_BATCH_MAX_SIZE);
+  preintegration_pairs_.reserve(MOTION_BATCH_MAX_SIZE);
 }
 
 Motions::~Motions() {
@@ -59,10 +85,31 @@ Motions::~Motions() {
 
 void Motions::SetMotionIntrinsics(const std::shared_ptr<MotionIntrinsics>& ex) {
   motion_intrinsics_ = ex;
+  UpdateCalibration();
+  if (motion_intrinsics_) {
+    auto&& in = *motion_intrinsics_;
+    UpdatePreintegrationParams([&in](PreintegrationParams* params) {
+      auto&& noise = params->noise;
+      std::copy(in.accel.noise, in.accel.noise + 3, noise.accel);
+      std::copy(in.gyro.noise, in.gyro.noise + 3, noise.gyro);
+      std::copy(in.accel.bias, in.accel.bias + 3, noise.accel_walk);
+      std::copy(in.gyro.bias, in.gyro.bias + 3, noise.gyro_walk);
+    });
+  }
 }
 
 void Motions::EnableProcessMode(const std::int32_t& mode) {
   proc_mode_ = mode;
+  UpdateCalibration();
+}
+
+void Motions::EnableMotionPairing(std::uint32_t rate) {
+  motion_pairing_rate_ = rate;
+  is_motion_pairing_enabled_ = true;
+}
+
+void Motions::DisableMotionPairing() {
+  is_motion_pairing_enabled_ = false;
 }
 
 void Motions::EnableMotionDatas(std::size_t max_size) {
@@ -72,6 +119,14 @@ void Motions::EnableMotionDatas(std::size_t max_size) {
   std::lock_guard<std::mutex> _(metux_);
   is_motion_datas_enabled_ = true;
   motion_datas_max_size_ = max_size;
+  if (max_size > 0 && max_size != motion_datas_.capacity()) {
+    // resized once here, keeps the latest ones
+    RingBuffer<ImuData> datas(max_size);
+    for (std::size_t i = 0; i < motion_datas_.size(); ++i) {
+      datas.push_back(std::move(motion_datas_[i]));
+    }
+    motion_datas_ = std::move(datas);
+  }
 }
 
 void Motions::DisableMotionDatas() {
@@ -80,6 +135,7 @@ void Motions::DisableMotionDatas() {
   is_motion_datas_enabled_ = false;
   motion_datas_max_size_ = 0;
   motion_datas_.clear();
+  motion_history_.clear();
 }
 
 bool Motions::IsMotionDatasEnabled() const {
@@ -92,7 +148,39 @@ Motions::datas_t Motions::GetMotionDatas() {
                 "motion callback instead");
   }
   std::lock_guard<std::mutex> _(metux_);
-  return std::move(motion_datas_);
+  datas_t datas;
+  datas.reserve(motion_datas_.size());
+  for (std::size_t i = 0; i < motion_datas_.size(); ++i) {
+    datas.push_back({std::make_shared<ImuData>(motion_datas_[i])});
+  }
+  motion_datas_.clear();
+  return datas;
+}
+
+Motions::datas_t Motions::GetMotionDatas(std::uint64_t from,
+    std::uint64_t to) {
+  datas_t datas;
+  if (to <= from) return datas;
+  std::lock_guard<std::mutex> _(metux_);
+  for (auto i = FindMotionHistory(from); i < motion_history_.size(); ++i) {
+    auto&& imu = motion_history_[i];
+    if (imu.timestamp > to) break;
+    datas.push_back({std::make_shared<ImuData>(imu)});
+  }
+  return datas;
+}
+
+std::size_t Motions::GetMotionDatas(std::uint64_t from, std::uint64_t to,
+    imu_datas_t* datas) {
+  if (to <= from || datas == nullptr) return 0;
+  std::size_t size = datas->size();
+  std::lock_guard<std::mutex> _(metux_);
+  for (auto i = FindMotionHistory(from); i < motion_history_.size(); ++i) {
+    auto&& imu = motion_history_[i];
+    if (imu.timestamp > to) break;
+    datas->push_back(imu);
+  }
+  return datas->size() - size;
 }
 
 void Motions::SetMotionCallback(motion_callback_t callback) {
@@ -100,12 +188,189 @@ void Motions::SetMotionCallback(motion_callback_t callback) {
   motion_callback_ = callback;
 }
 
+void Motions::SetMotionBatchCallback(motion_batch_callback_t callback) {
+  std::lock_guard<std::mutex> _(metux_);
+  motion_batch_callback_ = callback;
+}
+
 // call in thread of channels
-void Motions::OnImuDataCallback(const ImuDataPacket& packet) {
-  auto &&imu = std::make_shared<ImuData>();
+void Motions::OnImuDatasCallback(const std::vector<ImuDataPacket>& packets) {
+  motion_batch_.clear();
+  for (auto&& packet : packets) {
+    if (motion_count_ < 20) {
+      ++motion_count_;
+      continue;
+    }
+    motion_batch_.emplace_back();
+    if (!ProcImuData(packet, &motion_batch_.back())) {
+      motion_batch_.pop_back();
+    }
+  }
+  if (motion_batch_.empty()) return;
+
+  auto&& calib = std::atomic_load(&calibration_);
+  if (calib) {
+    ApplyCalibration(*calib, motion_batch_.data(), motion_batch_.size());
+  }
+
+  if (is_preintegration_enabled_) {
+    ProcPreintegration();
+    preintegration_pairs_.clear();
+    for (auto&& imu : motion_batch_) {
+      preintegration_pairing_.Put(imu, &preintegration_pairs_);
+    }
+  } else if (preintegrator_.IsStarted()) {
+    preintegrator_.Stop();
+    preintegration_pairing_.Reset();
+    preintegration_pairs_.clear();
+    preintegration_cuts_.clear();
+  }
+
+  if (is_motion_pairing_enabled_) {
+    std::uint32_t rate = motion_pairing_rate_;
+    if (!motion_pairing_ || motion_pairing_->rate() != rate) {
+      motion_pairing_.reset(new MotionPairing(rate));
+    }
+    motion_pairs_.clear();
+    for (auto&& imu : motion_batch_) {
+      motion_pairing_->Put(imu, &motion_pairs_);
+    }
+    std::swap(motion_batch_, motion_pairs_);
+    if (motion_batch_.empty()) return;
+  } else if (motion_pairing_) {
+    motion_pairing_.reset();
+  }
+
+  motion_callback_t callback;
+  motion_batch_callback_t batch_callback;
+  {
+    std::lock_guard<std::mutex> _(metux_);
+    for (auto&& imu : motion_batch_) {
+      if (motion_datas_max_size_ > 0) {
+        // overwrites the first one if data is full
+        motion_datas_.push_back(imu);
+      }
+
+      // the timestamps restart if the device reset, then the old ones not
+      // ordered
+      if (!motion_history_.empty()
+          && imu.timestamp < motion_history_.back().timestamp) {
+        motion_history_.clear();
+      }
+      motion_history_.push_back(imu);
+    }
+    callback = motion_callback_;
+    batch_callback = motion_batch_callback_;
+  }
+
+  // callback
+  if (batch_callback) {
+    batch_callback(motion_batch_.data(), motion_batch_.size());
+  }
+  if (callback) {
+    for (auto&& imu : motion_batch_) {
+      callback({std::make_shared<ImuData>(imu)});
+    }
+  }
+}
+
+void Motions::EnablePreintegration() {
+  is_preintegration_enabled_ = true;
+}
+
+void Motions::DisablePreintegration() {
+  is_preintegration_enabled_ = false;
+}
+
+void Motions::SetPreintegrationBias(const double (&accel)[3],
+    const double (&gyro)[3]) {
+  UpdatePreintegrationParams([&](PreintegrationParams* params) {
+    std::copy(accel, accel + 3, params->bias_accel);
+    std::copy(gyro, gyro + 3, params->bias_gyro);
+  });
+}
+
+std::shared_ptr<ImuPreintegration> Motions::GetPreintegration(
+    std::uint64_t to) {
+  std::lock_guard<std::mutex> _(preintegration_mutex_);
+  auto&& i = preintegrations_.partition_point(
+      [to](const std::shared_ptr<const ImuPreintegration>& preintegration) {
+        return preintegration->to < to;
+      });
+  if (i == preintegrations_.size() || preintegrations_[i]->to != to) {
+    return nullptr;
+  }
+  return std::make_shared<ImuPreintegration>(*preintegrations_[i]);
+}
+
+bool Motions::GetPreintegration(std::uint64_t from, std::uint64_t to,
+    ImuPreintegration* result) {
+  if (to <= from || result == nullptr) return false;
+  // the ones around, then each sensor has one at or before from
+  imu_datas_t datas;
+  {
+    std::lock_guard<std::mutex> _(metux_);
+    auto&& i = FindMotionHistory(from);
+    auto&& n = FindMotionHistory(to);
+    i = i > 4 ? i - 4 : 0;
+    n = std::min(n + 4, motion_history_.size());
+    datas.reserve(n - i);
+    for (; i < n; ++i) {
+      datas.push_back(motion_history_[i]);
+    }
+  }
+
+  imu_datas_t pairs;
+  MotionPairing pairing;
+  for (auto&& imu : datas) {
+    if (imu.flag == MYNTEYE_IMU_ACCEL_GYRO) {
+      pairs.push_back(imu);
+    } else {
+      pairing.Put(imu, &pairs);
+    }
+  }
+  if (pairs.empty() || pairs.front().timestamp > from
+      || pairs.back().timestamp < to) {
+    return false;
+  }
+
+  auto&& params = std::atomic_load(&preintegration_params_);
+  Preintegrator preintegrator;
+  preintegrator.SetNoise(params->noise);
+  preintegrator.SetBias(params->bias_accel, params->bias_gyro);
+  for (auto&& pair : pairs) {
+    if (!preintegrator.IsStarted() && pair.timestamp > from) {
+      preintegrator.Start(from);
+    }
+    if (pair.timestamp > to) break;
+    preintegrator.Put(pair);
+  }
+  preintegrator.IntegrateTo(to);
+  *result = preintegrator.result();
+  return true;
+}
+
+// call in thread of channels
+void Motions::OnImageInfoCallback(const ImgInfoPacket& packet) {
+  if (!is_preintegration_enabled_) return;
+  std::uint64_t time = packet.device_timestamp;
+  if (!preintegration_cuts_.empty()
+      && time <= preintegration_cuts_.back()) {
+    // the timestamps restart if the device reset
+    preintegration_cuts_.clear();
+    preintegrator_.Stop();
+  }
+  if (preintegration_cuts_.size() == preintegration_cuts_.capacity()) {
+    preintegration_cuts_.pop_front();
+  }
+  preintegration_cuts_.push_back(time);
+}
+
+bool Motions::ProcImuData(const ImuDataPacket& packet, ImuData* imu) const {
   imu->flag = packet.flag;
   imu->temperature = static_cast<double>(packet.temperature * 0.125 + 23);
-  imu->timestamp = packet.timestamp;
+  imu->timestamp = packet.device_timestamp;
+  imu->host_timestamp = packet.host_timestamp;
 
   if (imu->flag == MYNTEYE_IMU_ACCEL) {
     imu->accel[0] = packet.accel_or_gyro[0] * 12.f / 0x10000;
@@ -123,91 +388,123 @@ void Motions::OnImuDataCallback(const ImuDataPacket& packet) {
     imu->gyro[2] = packet.accel_or_gyro[2] * 2000.f / 0x10000;
   } else {
     LOGW("Unaccpected imu, flag=%d is wrong", imu->flag);
-    return;
-  }
-
-  if (motion_count_ < 20) {
-    ++motion_count_;
-    return;
+    return false;
   }
 
-  bool proc_assembly = ((proc_mode_ & ProcessMode::PROC_IMU_ASSEMBLY) > 0);
-  bool proc_temp_drift = ((proc_mode_ & ProcessMode::PROC_IMU_TEMP_DRIFT) > 0);
-  if (proc_assembly && proc_temp_drift) {
-    ProcImuTempDrift(imu);
-    ProcImuAssembly(imu);
-  } else if (proc_assembly) {
-    ProcImuAssembly(imu);
-  } else if (proc_temp_drift) {
-    ProcImuTempDrift(imu);
-  }
+  return true;
+}
 
-  std::lock_guard<std::mutex> _(metux_);
+std::size_t Motions::FindMotionHistory(std::uint64_t from) const {
+  return motion_history_.partition_point([from](const ImuData& imu) {
+    return imu.timestamp <= from;
+  });
+}
 
-  data_t data = {imu};
+void Motions::UpdatePreintegrationParams(
+    std::function<void(PreintegrationParams* params)> update) {
+  std::lock_guard<std::mutex> _(preintegration_mutex_);
+  auto&& params = std::make_shared<PreintegrationParams>(
+      *std::atomic_load(&preintegration_params_));
+  update(params.get());
+  std::atomic_store(&preintegration_params_,
+      std::shared_ptr<const PreintegrationParams>(std::move(params)));
+}
 
-  if (motion_datas_max_size_ > 0) {
-    // remove the first one if data is full
-    if (motion_datas_.size() > motion_datas_max_size_) {
-      motion_datas_.erase(motion_datas_.begin());
+void Motions::ProcPreintegration() {
+  auto&& params = std::atomic_load(&preintegration_params_);
+  if (params != preintegration_params_applied_) {
+    // biases applied since the next cut
+    preintegrator_.SetNoise(params->noise);
+    preintegrator_.SetBias(params->bias_accel, params->bias_gyro);
+    preintegration_params_applied_ = params;
+  }
+  for (auto&& pair : preintegration_pairs_) {
+    while (!preintegration_cuts_.empty()
+        && preintegration_cuts_.front() <= pair.timestamp) {
+      CutPreintegration(preintegration_cuts_.front());
+      preintegration_cuts_.pop_front();
     }
-    motion_datas_.push_back(data);
+    preintegrator_.Put(pair);
   }
+}
 
-  // callback
-  if (motion_callback_) {
-    motion_callback_(data);
+void Motions::CutPreintegration(std::uint64_t time) {
+  if (preintegrator_.IntegrateTo(time)) {
+    auto&& preintegration =
+        std::make_shared<const ImuPreintegration>(preintegrator_.result());
+    std::lock_guard<std::mutex> _(preintegration_mutex_);
+    if (!preintegrations_.empty()
+        && time <= preintegrations_.back()->to) {
+      // the timestamps restart if the device reset
+      preintegrations_.clear();
+    }
+    preintegrations_.push_back(std::move(preintegration));
   }
+  preintegrator_.Start(time);
 }
 
-void Motions::ProcImuAssembly(std::shared_ptr<ImuData> data) const {
-  if (nullptr == motion_intrinsics_) return;
+void Motions::UpdateCalibration() {
+  bool proc_assembly = ((proc_mode_ & ProcessMode::PROC_IMU_ASSEMBLY) > 0);
+  bool proc_temp_drift = ((proc_mode_ & ProcessMode::PROC_IMU_TEMP_DRIFT) > 0);
+  if (nullptr == motion_intrinsics_ || !(proc_assembly || proc_temp_drift)) {
+    std::atomic_store(&calibration_,
+        std::shared_ptr<const Calibration>(nullptr));
+    return;
+  }
 
-  double dst[3][3] = {0};
-  if (data->flag == 1) {
-    matrix_3x3(motion_intrinsics_->accel.scale,
-        motion_intrinsics_->accel.assembly, dst);
-    double s[3][1] = {0};
-    double d[3][1] = {0};
-    for (int i = 0; i < 3; i++) {
-      s[i][0] = data->accel[i];
-    }
-    matrix_3x1(dst, s, d);
-    for (int i = 0; i < 3; i++) {
-      data->accel[i] = d[i][0];
-    }
-  } else if (data->flag == 2) {
-    matrix_3x3(motion_intrinsics_->gyro.scale,
-        motion_intrinsics_->gyro.assembly, dst);
-    double s[3][1] = {0};
-    double d[3][1] = {0};
-    for (int i = 0; i < 3; i++) {
-      s[i][0] = data->gyro[i];
-    }
-    matrix_3x1(dst, s, d);
+  auto&& calib = std::make_shared<Calibration>();
+  auto&& update = [&](const ImuIntrinsics& in,
+      Calibration::Transform* transform) {
+    transform->temp_drift = proc_temp_drift;
+    const double* drifts[3] = {in.x, in.y, in.z};
     for (int i = 0; i < 3; i++) {
-      data->gyro[i] = d[i][0];
+      transform->drift_constant[i] = drifts[i][0];
+      transform->drift_slope[i] = drifts[i][1];
     }
-  }
+    transform->assembly = proc_assembly;
+    std::fill(&transform->matrix[0][0], &transform->matrix[0][0] + 9, 0.);
+    matrix_3x3(in.scale, in.assembly, transform->matrix);
+  };
+  update(motion_intrinsics_->accel, &calib->accel);
+  update(motion_intrinsics_->gyro, &calib->gyro);
+  std::atomic_store(&calibration_,
+      std::shared_ptr<const Calibration>(std::move(calib)));
 }
 
-void Motions::ProcImuTempDrift(std::shared_ptr<ImuData> data) const {
-  if (nullptr == motion_intrinsics_) return;
+// Drift first then assembly, in the same order of operations as ever, so
+// the results are the same as applying them apart.
+void Motions::ApplyCalibration(const Calibration& calib, ImuData* datas,
+    std::size_t count) {
+  for (std::size_t n = 0; n < count; n++) {
+    auto&& data = datas[n];
+    const Calibration::Transform* transform;
+    double* v;
+    if (data.flag == MYNTEYE_IMU_ACCEL) {
+      transform = &calib.accel;
+      v = data.accel;
+    } else if (data.flag == MYNTEYE_IMU_GYRO) {
+      transform = &calib.gyro;
+      v = data.gyro;
+    } else {
+      continue;
+    }
 
-  double temp = data->temperature;
-  if (data->flag == 1) {
-    data->accel[0] -= motion_intrinsics_->accel.x[1] * temp
-      + motion_intrinsics_->accel.x[0];
-    data->accel[1] -= motion_intrinsics_->accel.y[1] * temp
-      + motion_intrinsics_->accel.y[0];
-    data->accel[2] -= motion_intrinsics_->accel.z[1] * temp
-      + motion_intrinsics_->accel.z[0];
-  } else if (data->flag == 2) {
-    data->gyro[0] -= motion_intrinsics_->gyro.x[1] * temp
-      + motion_intrinsics_->gyro.x[0];
-    data->gyro[1] -= motion_intrinsics_->gyro.y[1] * temp
-      + motion_intrinsics_->gyro.y[0];
-    data->gyro[2] -= motion_intrinsics_->gyro.z[1] * temp
-      + motion_intrinsics_->gyro.z[0];
+    if (transform->temp_drift) {
+      double temp = data.temperature;
+      for (int i = 0; i < 3; i++) {
+        v[i] -= transform->drift_slope[i] * temp
+            + transform->drift_constant[i];
+      }
+    }
+    if (transform->assembly) {
+      double s[3] = {v[0], v[1], v[2]};
+      for (int i = 0; i < 3; i++) {
+        double d = 0;
+        for (int k = 0; k < 3; k++) {
+          d += transform->matrix[i][k] * s[k];
+        }
+        v[i] = d;
+      }
+    }
   }
 }
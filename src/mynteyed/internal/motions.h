@@ -15,12 +15,17 @@
 #define MYNTEYE_INTERNAL_MOTIONS_H_
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "mynteyed/data/types_internal.h"
+#include "mynteyed/internal/motion_pairing.h"
+#include "mynteyed/internal/preintegration.h"
+#include "mynteyed/internal/ring_buffer.h"
 #include "mynteyed/types.h"
 
 MYNTEYE_BEGIN_NAMESPACE
@@ -30,7 +35,12 @@ class Motions {
   using data_t = MotionData;
   using datas_t = std::vector<data_t>;
 
+  using imu_datas_t = std::vector<ImuData>;
+
   using motion_callback_t = std::function<void(const MotionData& data)>;
+  // imu datas of one hid read, contiguous
+  using motion_batch_callback_t =
+      std::function<void(const ImuData* datas, std::size_t count)>;
 
   Motions();
   ~Motions();
@@ -39,6 +49,13 @@ class Motions {
 
   void EnableProcessMode(const std::int32_t& mode);
 
+  /**
+   * Enable motion pairing, then the datas are accel and gyro paired at the
+   * times of the rate in hz, or of the gyro if rate is 0.
+   */
+  void EnableMotionPairing(std::uint32_t rate);
+  void DisableMotionPairing();
+
   /**
    * Enable motion datas.
    *
@@ -52,29 +69,110 @@ class Motions {
   bool IsMotionDatasEnabled() const;
 
   datas_t GetMotionDatas();
+  /**
+   * Get the motion datas from (exclusive) to (inclusive) by the timestamps,
+   * of the recent ones kept. Not drained as GetMotionDatas().
+   */
+  datas_t GetMotionDatas(std::uint64_t from, std::uint64_t to);
+  // Same as above, but appends to datas, returns how many
+  std::size_t GetMotionDatas(std::uint64_t from, std::uint64_t to,
+      imu_datas_t* datas);
 
   void SetMotionCallback(motion_callback_t callback);
+  void SetMotionBatchCallback(motion_batch_callback_t callback);
 
-  void OnImuDataCallback(const ImuDataPacket& packet);
+  /**
+   * Enable preintegration, between the timestamps of the image infos as
+   * they come. Noise densities and random walks are of the intrinsics.
+   */
+  void EnablePreintegration();
+  void DisablePreintegration();
+  // Biases subtracted since the next interval, in SI
+  void SetPreintegrationBias(const double (&accel)[3],
+      const double (&gyro)[3]);
+  // Preintegration till the image timestamp, nullptr if not integrated yet
+  std::shared_ptr<ImuPreintegration> GetPreintegration(std::uint64_t to);
+  // Preintegrates the recent ones kept from to, false if not covered
+  bool GetPreintegration(std::uint64_t from, std::uint64_t to,
+      ImuPreintegration* result);
+
+  void OnImuDatasCallback(const std::vector<ImuDataPacket>& packets);
+  void OnImageInfoCallback(const ImgInfoPacket& packet);
 
  private:
-  void ProcImuAssembly(std::shared_ptr<ImuData> data) const;
-  void ProcImuTempDrift(std::shared_ptr<ImuData> data) const;
+  struct PreintegrationParams {
+    Preintegrator::Noise noise;
+    double bias_accel[3];
+    double bias_gyro[3];
+  };
+  // Temperature drift and assembly, fused into one transform each sensor
+  struct Calibration;
+
+  // false if unexpected
+  bool ProcImuData(const ImuDataPacket& packet, ImuData* data) const;
+
+  // Precomputes the calibration of the intrinsics and process mode
+  void UpdateCalibration();
+  static void ApplyCalibration(const Calibration& calib, ImuData* datas,
+      std::size_t count);
+
+  // Index of the first one after from in history
+  std::size_t FindMotionHistory(std::uint64_t from) const;
+
+  void UpdatePreintegrationParams(
+      std::function<void(PreintegrationParams* params)> update);
+  // Integrates the pairs of the previous reads, till the image timestamps
+  void ProcPreintegration();
+  void CutPreintegration(std::uint64_t time);
 
   std::shared_ptr<MotionIntrinsics> motion_intrinsics_;
 
   std::int32_t proc_mode_;
 
+  // nullptr if nothing to process, swapped atomically as used on the thread
+  // of channels
+  std::shared_ptr<const Calibration> calibration_;
+
   bool is_motion_datas_enabled_;
   std::size_t motion_datas_max_size_;
 
-  datas_t motion_datas_;
+  // Values inline, wrapped into data_t only as got; the latest max size kept
+  RingBuffer<ImuData> motion_datas_;
+  // Recent ones in order of the timestamps, to get by them
+  RingBuffer<ImuData> motion_history_;
 
   std::mutex metux_;
 
   motion_callback_t motion_callback_;
+  motion_batch_callback_t motion_batch_callback_;
 
   std::uint32_t motion_count_;
+
+  std::atomic<bool> is_motion_pairing_enabled_;
+  std::atomic<std::uint32_t> motion_pairing_rate_;
+
+  std::atomic<bool> is_preintegration_enabled_;
+  // Swapped atomically as motion calibration
+  std::shared_ptr<const PreintegrationParams> preintegration_params_;
+  // Guards updating params, and the results
+  std::mutex preintegration_mutex_;
+  RingBuffer<std::shared_ptr<const ImuPreintegration>> preintegrations_;
+
+  // Only on the thread of channels below
+
+  // Of the hid read in process, reused
+  imu_datas_t motion_batch_;
+  imu_datas_t motion_pairs_;
+  std::unique_ptr<MotionPairing> motion_pairing_;
+
+  std::shared_ptr<const PreintegrationParams> preintegration_params_applied_;
+  MotionPairing preintegration_pairing_;
+  // Paired of the last read, integrated as the next comes, as then the image
+  // timestamps among them all known
+  imu_datas_t preintegration_pairs_;
+  // Image timestamps to cut at
+  RingBuffer<std::uint64_t> preintegration_cuts_;
+  Preintegrator preintegrator_;
 };
 
 MYNTEYE_END_NAMESPACE
@@ -0,0 +1,251 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/internal/preintegration.h"
+
+#include <algorithm>
+#include <cmath>
+
+// timestamps in 0.01ms
+#define PREINTEGRATION_TIMESTAMP_RATE 100000.
+#define PREINTEGRATION_GRAVITY 9.80665
+#define PREINTEGRATION_DEG_TO_RAD 0.017453292519943295
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace {
+
+using mat3_t = double[3][3];
+
+void skew(const double (&v)[3], mat3_t& m) {  // NOLINT
+  m[0][0] = 0;     m[0][1] = -v[2]; m[0][2] = v[1];
+  m[1][0] = v[2];  m[1][1] = 0;     m[1][2] = -v[0];
+  m[2][0] = -v[1]; m[2][1] = v[0];  m[2][2] = 0;
+}
+
+void mul(const mat3_t& a, const mat3_t& b, mat3_t& dst) {  // NOLINT
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      dst[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+    }
+  }
+}
+
+void mul_transposed(const mat3_t& a, const mat3_t& b, mat3_t& dst) {  // NOLINT
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      dst[i][j] = a[0][i] * b[0][j] + a[1][i] * b[1][j] + a[2][i] * b[2][j];
+    }
+  }
+}
+
+// Exp of so(3) and its right jacobian
+void exp_so3(const double (&phi)[3], mat3_t& rotation,  // NOLINT
+    mat3_t& jacobian) {  // NOLINT
+  double theta2 = phi[0] * phi[0] + phi[1] * phi[1] + phi[2] * phi[2];
+  double theta = std::sqrt(theta2);
+  mat3_t w, w2;
+  skew(phi, w);
+  mul(w, w, w2);
+  double a, b, c, d;
+  if (theta < 1e-8) {
+    a = 1;
+    b = 0.5;
+    c = 0.5;
+    d = 1. / 6;
+  } else {
+    a = std::sin(theta) / theta;
+    b = (1 - std::cos(theta)) / theta2;
+    c = b;
+    d = (theta - std::sin(theta)) / (theta2 * theta);
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      double identity = i == j ? 1 : 0;
+      rotation[i][j] = identity + a * w[i][j] + b * w2[i][j];
+      jacobian[i][j] = identity - c * w[i][j] + d * w2[i][j];
+    }
+  }
+}
+
+}  // namespace
+
+Preintegrator::Preintegrator()
+  : has_sample_(false), is_started_(false), time_(0) {
+  std::fill(&noise_.accel[0], &noise_.accel[0] + 3, 0);
+  std::fill(&noise_.gyro[0], &noise_.gyro[0] + 3, 0);
+  std::fill(&noise_.accel_walk[0], &noise_.accel_walk[0] + 3, 0);
+  std::fill(&noise_.gyro_walk[0], &noise_.gyro_walk[0] + 3, 0);
+  std::fill(bias_accel_, bias_accel_ + 3, 0);
+  std::fill(bias_gyro_, bias_gyro_ + 3, 0);
+}
+
+void Preintegrator::SetNoise(const Noise& noise) {
+  noise_ = noise;
+}
+
+void Preintegrator::SetBias(const double (&accel)[3],
+    const double (&gyro)[3]) {
+  std::copy(accel, accel + 3, bias_accel_);
+  std::copy(gyro, gyro + 3, bias_gyro_);
+}
+
+void Preintegrator::Start(std::uint64_t time) {
+  result_.Reset();
+  result_.from = time;
+  result_.to = time;
+  std::copy(bias_accel_, bias_accel_ + 3, result_.bias_accel);
+  std::copy(bias_gyro_, bias_gyro_ + 3, result_.bias_gyro);
+  time_ = time;
+  is_started_ = true;
+}
+
+void Preintegrator::Put(const ImuData& imu) {
+  if (imu.flag != MYNTEYE_IMU_ACCEL_GYRO) return;
+  if (is_started_ && has_sample_ && imu.timestamp > time_) {
+    Integrate(imu.timestamp);
+    ++result_.count;
+  }
+  sample_ = imu;
+  has_sample_ = true;
+}
+
+void Preintegrator::Stop() {
+  has_sample_ = false;
+  is_started_ = false;
+}
+
+bool Preintegrator::IntegrateTo(std::uint64_t time) {
+  if (!is_started_ || !has_sample_) return false;
+  if (time > time_) Integrate(time);
+  return true;
+}
+
+void Preintegrator::Integrate(std::uint64_t time) {
+  double dt = (time - time_) / PREINTEGRATION_TIMESTAMP_RATE;
+  double dt2 = dt * dt;
+  time_ = time;
+
+  auto&& r = result_;
+
+  // g to m/s^2, deg/s to rad/s, without biases
+  double acc[3], phi[3];
+  for (int i = 0; i < 3; i++) {
+    acc[i] = sample_.accel[i] * PREINTEGRATION_GRAVITY - r.bias_accel[i];
+    phi[i] = (sample_.gyro[i] * PREINTEGRATION_DEG_TO_RAD - r.bias_gyro[i])
+        * dt;
+  }
+  mat3_t dr, jr;
+  exp_so3(phi, dr, jr);
+  mat3_t acc_skew, r_acc_skew;
+  skew(acc, acc_skew);
+  mul(r.delta_rotation, acc_skew, r_acc_skew);
+
+  // Covariance, A * cov * A^T + B * noise * B^T
+  //   A = [dr^T, 0, 0; -R[a]dt, I, 0; -R[a]dt^2/2, Idt, I]
+  double a[9][9] = {};
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      a[i][j] = dr[j][i];
+      a[3 + i][j] = -r_acc_skew[i][j] * dt;
+      a[6 + i][j] = -0.5 * r_acc_skew[i][j] * dt2;
+    }
+    a[3 + i][3 + i] = 1;
+    a[6 + i][3 + i] = dt;
+    a[6 + i][6 + i] = 1;
+  }
+  double ac[9][9];
+  for (int i = 0; i < 9; i++) {
+    for (int j = 0; j < 9; j++) {
+      double sum = 0;
+      for (int k = 0; k < 9; k++) sum += a[i][k] * r.covariance[k][j];
+      ac[i][j] = sum;
+    }
+  }
+  for (int i = 0; i < 9; i++) {
+    for (int j = 0; j < 9; j++) {
+      double sum = 0;
+      for (int k = 0; k < 9; k++) sum += ac[i][k] * a[j][k];
+      r.covariance[i][j] = sum;
+    }
+  }
+  //   B = [Jr dt, 0; 0, R dt; 0, R dt^2/2], noise discretized by 1/dt
+  double b[9][6] = {};
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      b[i][j] = jr[i][j] * dt;
+      b[3 + i][3 + j] = r.delta_rotation[i][j] * dt;
+      b[6 + i][3 + j] = 0.5 * r.delta_rotation[i][j] * dt2;
+    }
+  }
+  if (dt > 0) {
+    double n[6];
+    for (int i = 0; i < 3; i++) {
+      n[i] = noise_.gyro[i] / dt;
+      n[3 + i] = noise_.accel[i] / dt;
+    }
+    for (int i = 0; i < 9; i++) {
+      for (int j = 0; j < 9; j++) {
+        double sum = 0;
+        for (int k = 0; k < 6; k++) sum += b[i][k] * n[k] * b[j][k];
+        r.covariance[i][j] += sum;
+      }
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    r.bias_covariance[i] += noise_.accel_walk[i] * dt;
+    r.bias_covariance[3 + i] += noise_.gyro_walk[i] * dt;
+  }
+
+  // Jacobians to the biases, by the rotation before this step
+  mat3_t r_acc_skew_dbg;
+  mul(r_acc_skew, r.d_rotation_d_bias_gyro, r_acc_skew_dbg);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      r.d_position_d_bias_accel[i][j] += r.d_velocity_d_bias_accel[i][j] * dt
+          - 0.5 * r.delta_rotation[i][j] * dt2;
+      r.d_position_d_bias_gyro[i][j] += r.d_velocity_d_bias_gyro[i][j] * dt
+          - 0.5 * r_acc_skew_dbg[i][j] * dt2;
+      r.d_velocity_d_bias_accel[i][j] -= r.delta_rotation[i][j] * dt;
+      r.d_velocity_d_bias_gyro[i][j] -= r_acc_skew_dbg[i][j] * dt;
+    }
+  }
+  mat3_t d_rotation_d_bias_gyro;
+  mul_transposed(dr, r.d_rotation_d_bias_gyro, d_rotation_d_bias_gyro);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      r.d_rotation_d_bias_gyro[i][j] = d_rotation_d_bias_gyro[i][j]
+          - jr[i][j] * dt;
+    }
+  }
+
+  // Deltas
+  double r_acc[3];
+  for (int i = 0; i < 3; i++) {
+    r_acc[i] = r.delta_rotation[i][0] * acc[0]
+        + r.delta_rotation[i][1] * acc[1] + r.delta_rotation[i][2] * acc[2];
+  }
+  for (int i = 0; i < 3; i++) {
+    r.delta_position[i] += r.delta_velocity[i] * dt + 0.5 * r_acc[i] * dt2;
+    r.delta_velocity[i] += r_acc[i] * dt;
+  }
+  mat3_t delta_rotation;
+  mul(r.delta_rotation, dr, delta_rotation);
+  std::copy(&delta_rotation[0][0], &delta_rotation[0][0] + 9,
+      &r.delta_rotation[0][0]);
+
+  r.to = time;
+  r.dt += dt;
+}
+
+MYNTEYE_END_NAMESPACE
@@ -0,0 +1,78 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_INTERNAL_PREINTEGRATION_H_
+#define MYNTEYE_INTERNAL_PREINTEGRATION_H_
+#pragma once
+
+#include <cstdint>
+
+#include "mynteyed/types.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Preintegrates paired imu samples on manifold, as they come.
+ *
+ * Each sample holds from its timestamp till the next, so the interval could
+ * end between samples. Rotation, velocity and position deltas propagate with
+ * their covariance and the jacobians to the biases, per Forster et al.,
+ * "On-Manifold Preintegration for Real-Time Visual-Inertial Odometry".
+ */
+class Preintegrator {
+ public:
+  // Variance densities, of the measurements and bias random walks, in SI
+  struct Noise {
+    double accel[3];
+    double gyro[3];
+    double accel_walk[3];
+    double gyro_walk[3];
+  };
+
+  Preintegrator();
+
+  void SetNoise(const Noise& noise);
+  // Subtracted from the samples since the next start, in SI
+  void SetBias(const double (&accel)[3], const double (&gyro)[3]);
+
+  bool IsStarted() const { return is_started_; }
+
+  // Starts at time, from the sample held
+  void Start(std::uint64_t time);
+  // Stops and drops the sample held
+  void Stop();
+  // Integrates the sample held till imu, then holds it. Only paired ones.
+  void Put(const ImuData& imu);
+  // Integrates the sample held till time, false if not started or none
+  bool IntegrateTo(std::uint64_t time);
+
+  const ImuPreintegration& result() const { return result_; }
+
+ private:
+  void Integrate(std::uint64_t time);
+
+  Noise noise_;
+  double bias_accel_[3];
+  double bias_gyro_[3];
+
+  bool has_sample_;
+  ImuData sample_;
+
+  bool is_started_;
+  std::uint64_t time_;
+  ImuPreintegration result_;
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_INTERNAL_PREINTEGRATION_H_
@@ -0,0 +1,105 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_INTERNAL_RING_BUFFER_H_
+#define MYNTEYE_INTERNAL_RING_BUFFER_H_
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Keeps the latest items at most the capacity, the oldest overwritten over
+ * it. Indexed from the oldest, all in O(1) without allocating once full.
+ */
+template <typename T>
+class RingBuffer {
+ public:
+  using size_type = std::size_t;
+
+  explicit RingBuffer(size_type capacity)
+    : items_(capacity > 0 ? capacity : 1), head_(0), size_(0) {}
+
+  size_type capacity() const { return items_.size(); }
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T& operator[](size_type i) { return items_[Index(i)]; }
+  const T& operator[](size_type i) const { return items_[Index(i)]; }
+
+  T& front() { return items_[head_]; }
+  const T& front() const { return items_[head_]; }
+  T& back() { return items_[Index(size_ - 1)]; }
+  const T& back() const { return items_[Index(size_ - 1)]; }
+
+  void push_back(T item) {
+    if (size_ < items_.size()) {
+      items_[Index(size_)] = std::move(item);
+      ++size_;
+    } else {
+      items_[head_] = std::move(item);
+      head_ = Index(1);
+    }
+  }
+
+  // Released as overwritten
+  void pop_front() {
+    head_ = Index(1);
+    --size_;
+  }
+
+  // Keeps the storage, items released as overwritten
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * Index of the first item pred false, size() if none. Items must be
+   * partitioned by pred, all true before all false. In O(log n).
+   */
+  template <typename Pred>
+  size_type partition_point(Pred pred) const {
+    size_type first = 0;
+    size_type count = size_;
+    while (count > 0) {
+      size_type step = count / 2;
+      if (pred((*this)[first + step])) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+ private:
+  size_type Index(size_type i) const {
+    i += head_;
+    return i < items_.size() ? i : i - items_.size();
+  }
+
+  std::vector<T> items_;
+  size_type head_;
+  size_type size_;
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_INTERNAL_RING_BUFFER_H_
@@ -13,19 +13,36 @@
 // limitations under the License.
 #include "mynteyed/internal/streams.h"
 
+#include <algorithm>
+
 #include "mynteyed/device/device.h"
 #include "mynteyed/util/log.h"
-#include "mynteyed/util/rate.h"
 #include "mynteyed/util/strings.h"
-#include "mynteyed/util/times.h"
+#include "mynteyed/util/threads.h"
 
 // set 1 only for the latest stream data
 #define STREAM_DATAS_MAX_SIZE 4
-#define IMG_INFO_QUEUE_MAX_SIZE 120  // 60fps, 2s
-#define IMG_INFO_SYNC_FREQUENCY 100  // 100hz
+// frame ids indexed to sync, and how long unmatched ones kept
+#define STREAM_SYNC_WINDOW 128
+#define STREAM_SYNC_MAX_AGE_MS 2000  // 60fps, 120 frames
+// wait before reading again if failed, or checking again if not enabled
+#define STREAM_CAPTURE_RETRY_MS 2
+#define STREAM_CAPTURE_IDLE_MS 100
 
 MYNTEYE_USE_NAMESPACE
 
+namespace {
+
+// the device timestamp synced if info, otherwise when captured
+std::int64_t host_timestamp_of(const Streams::CapturedImage& captured,
+    const Streams::img_info_ptr_t& info) {
+  if (info && info->host_timestamp != 0) return info->host_timestamp;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      captured.time.time_since_epoch()).count();
+}
+
+}  // namespace
+
 Streams::Streams(std::shared_ptr<Device> device)
   : device_(device),
     all_image_types_({
@@ -38,15 +55,13 @@ Streams::Streams(std::shared_ptr<Device> device)
     is_right_color_supported_(false),
     stream_datas_max_size_(STREAM_DATAS_MAX_SIZE),
     is_stream_capturing_(false),
-    stream_queue_map_({
-      {STREAM_COLOR, std::make_shared<stream_queue_t>(stream_datas_max_size_)},
-      {STREAM_DEPTH, std::make_shared<stream_queue_t>(stream_datas_max_size_)}
-    }),
-    stream_info_queue_map_({
-      {STREAM_COLOR,
-          std::make_shared<img_info_queue_t>(IMG_INFO_QUEUE_MAX_SIZE)},
-      {STREAM_DEPTH,
-          std::make_shared<img_info_queue_t>(IMG_INFO_QUEUE_MAX_SIZE)},
+    stream_sync_map_({
+      {STREAM_COLOR, std::make_shared<stream_sync_t>(STREAM_SYNC_WINDOW,
+          std::chrono::milliseconds(STREAM_SYNC_MAX_AGE_MS),
+          stream_datas_max_size_)},
+      {STREAM_DEPTH, std::make_shared<stream_sync_t>(STREAM_SYNC_WINDOW,
+          std::chrono::milliseconds(STREAM_SYNC_MAX_AGE_MS),
+          stream_datas_max_size_)}
     }),
     img_data_queue_map_({
       {ImageType::IMAGE_LEFT_COLOR,
@@ -56,6 +71,12 @@ Streams::Streams(std::shared_ptr<Device> device)
       {ImageType::IMAGE_DEPTH,
           std::make_shared<img_data_queue_t>(stream_datas_max_size_)}
     }),
+    motion_datas_getter_(nullptr),
+    preintegration_getter_(nullptr),
+    motion_datas_from_map_({
+      {ImageType::IMAGE_LEFT_COLOR, 0},
+      {ImageType::IMAGE_RIGHT_COLOR, 0},
+      {ImageType::IMAGE_DEPTH, 0}}),
     img_info_callback_(nullptr),
     img_data_callbacks_({
       {ImageType::IMAGE_LEFT_COLOR, nullptr},
@@ -64,6 +85,7 @@ Streams::Streams(std::shared_ptr<Device> device)
 }
 
 Streams::~Streams() {
+  StopStreamCapturing();
 }
 
 void Streams::EnableImageInfo(bool sync) {
@@ -127,10 +149,12 @@ void Streams::DisableStreamData(const ImageType& type) {
 }
 
 bool Streams::IsStreamDataEnabled(const ImageType& type) const {
+  std::lock_guard<std::mutex> _(stream_enabled_mutex_);
   return is_image_enabled_set_.find(type) != is_image_enabled_set_.end();
 }
 
 bool Streams::HasStreamDataEnabled() const {
+  std::lock_guard<std::mutex> _(stream_enabled_mutex_);
   return !is_image_enabled_set_.empty();
 }
 
@@ -142,9 +166,9 @@ void Streams::EnableStreamDatas(std::size_t max_size) {
   }
   stream_datas_max_size_ = size;
 
-  // Limit the stream queue
+  // Limit the streams pending to sync
   for (auto&& type : all_stream_types_) {
-    stream_queue_map_[type] = std::make_shared<stream_queue_t>(size);
+    stream_sync_map_[type]->SetMaxStreams(size);
   }
   // Limit the img data queue
   for (auto&& type : all_image_types_) {
@@ -184,8 +208,79 @@ void Streams::SetStreamCallback(const ImageType& type,
   img_data_callbacks_[type] = callback;
 }
 
+void Streams::SetMotionDatasGetter(motion_datas_getter_t getter) {
+  std::lock_guard<std::mutex> _(motion_datas_getter_mutex_);
+  motion_datas_getter_ = getter;
+}
+
+void Streams::SetPreintegrationGetter(preintegration_getter_t getter) {
+  std::lock_guard<std::mutex> _(motion_datas_getter_mutex_);
+  preintegration_getter_ = getter;
+}
+
+void Streams::SetFrameSetOptions(const FrameSetOptions& options) {
+  frame_sets_.SetOptions(options);
+}
+
+FrameSet Streams::GetFrameSet() {
+  device_->CheckOpened(__func__);
+
+  if (!HasStreamDataEnabled()) {
+    LOGW("Warning: Please enable stream datas, before you wanna get the "
+        "frame sets of them. There is not data return this time.");
+    return {};
+  }
+
+  return frame_sets_.Get();
+}
+
+void Streams::SetFrameSetCallback(FrameSets::frameset_callback_t callback) {
+  frame_sets_.SetCallback(callback);
+}
+
+StreamSyncStats Streams::GetStreamSyncStats(const ImageType& type) const {
+  StreamSyncStats stats;
+  if (type == ImageType::IMAGE_ALL) return stats;
+  auto&& sync_stats = stream_sync_map_.at(GetStreamType(type))->GetStats();
+  stats.matched = sync_stats.matched;
+  stats.stream_orphans = sync_stats.stream_orphans;
+  stats.info_orphans = sync_stats.info_orphans;
+  if (sync_stats.matched > 0) {
+    stats.average_us = static_cast<double>(sync_stats.latency_sum_us)
+        / sync_stats.matched;
+  }
+  stats.max_us = sync_stats.latency_max_us;
+  return stats;
+}
+
+StreamLatency Streams::GetStreamLatency(const ImageType& type) const {
+  StreamLatency latency;
+  if (type == ImageType::IMAGE_ALL) return latency;
+  std::lock_guard<std::mutex> _(latency_mutex_);
+  auto&& it = latency_map_.find(type);
+  if (it != latency_map_.end() && it->second.frames > 0) {
+    auto&& stats = it->second;
+    latency.frames = stats.frames;
+    latency.average_us = static_cast<double>(stats.sum_us) / stats.frames;
+    latency.max_us = stats.max_us;
+  }
+  auto&& read_it = read_wait_map_.find(GetStreamType(type));
+  if (read_it != read_wait_map_.end() && read_it->second.frames > 0) {
+    auto&& stats = read_it->second;
+    latency.read_wait_us = static_cast<double>(stats.sum_us) / stats.frames;
+  }
+  return latency;
+}
+
 void Streams::OnCameraOpen() {
   is_right_color_supported_ = device_->IsRightColorSupported();
+  ResetStreamLatency();
+  {
+    std::lock_guard<std::mutex> _(motion_datas_getter_mutex_);
+    for (auto&& from : motion_datas_from_map_) {
+      from.second = 0;
+    }
+  }
   StartStreamCapturing();
 }
 
@@ -199,14 +294,19 @@ void Streams::OnImageInfoCallback(const ImgInfoPacket& packet) {
   img_info->frame_id = packet.frame_id;
   img_info->timestamp = packet.timestamp;
   img_info->exposure_time = packet.exposure_time;
+  img_info->device_timestamp = packet.device_timestamp;
+  img_info->host_timestamp = packet.host_timestamp;
 
   if (is_image_info_sync_) {
-    // push info
-    
-    for (auto&& info : stream_info_queue_map_) {
-      info.second->Put(img_info);
+    // sync info with the stream of each
+    for (auto&& type : all_stream_types_) {
+      if (!IsStreamEnabled(type)) continue;
+      CapturedImage stream;
+      if (stream_sync_map_[type]->PutInfo(img_info->frame_id, img_info,
+          &stream)) {
+        OnStreamSyncedInfoCaptured(type, stream, img_info);
+      }
     }
-    SyncStreamWithInfo(false);
   }
 
   // callback
@@ -244,23 +344,59 @@ void Streams::StartStreamCapturing() {
   }
 
   is_stream_capturing_ = true;
-  stream_capture_thread_ = std::thread([this]() {
-    // Rate rate(device_->GetOpenParams().framerate);
-    Rate rate(100);
-    while (is_stream_capturing_) {
-      CaptureStreamColor();
-      CaptureStreamDepth();
-      SyncStreamWithInfo(true);
-      rate.Sleep();
-    }
-  });
+  for (auto&& type : all_stream_types_) {
+    stream_capture_threads_[type] = std::thread(
+        &Streams::RunStreamCapturing, this, type);
+  }
 }
 
 void Streams::StopStreamCapturing() {
   if (!is_stream_capturing_) return;
-  is_stream_capturing_ = false;
-  if (stream_capture_thread_.joinable()) {
-    stream_capture_thread_.join();
+  {
+    std::lock_guard<std::mutex> _(stream_capture_mutex_);
+    is_stream_capturing_ = false;
+  }
+  stream_capture_condition_.notify_all();
+  // Each returns from reading the device once a frame or timeout
+  for (auto&& thread : stream_capture_threads_) {
+    if (thread.second.joinable()) {
+      thread.second.join();
+    }
+  }
+  stream_capture_threads_.clear();
+}
+
+void Streams::RunStreamCapturing(const StreamType& type) {
+  bool is_color = type == STREAM_COLOR;
+  auto&& name = is_color ? "color" : "depth";
+  auto&& params = device_->GetOpenParams();
+  auto&& cpu = is_color ? params.capture_color_cpu : params.capture_depth_cpu;
+  if (cpu >= 0 && !threads::set_affinity(cpu)) {
+    LOGW("Could not pin the %s capture thread to cpu %d", name, cpu);
+  }
+  if (params.capture_high_priority && !threads::set_high_priority()) {
+    LOGW("Could not raise the priority of the %s capture thread", name);
+  }
+
+  while (is_stream_capturing_) {
+    bool enabled = IsStreamEnabled(type);
+    // Blocks reading the device, delivers the frame once it arrives
+    if (enabled && (is_color ? CaptureStreamColor() : CaptureStreamDepth())) {
+      continue;
+    }
+    // Not enabled, or failed to read; woken if enabled or stopped
+    std::unique_lock<std::mutex> lock(stream_capture_mutex_);
+    if (enabled) {
+      stream_capture_condition_.wait_for(lock,
+          std::chrono::milliseconds(STREAM_CAPTURE_RETRY_MS),
+          [this]() { return !is_stream_capturing_; });
+    } else {
+      stream_capture_condition_.wait_for(lock,
+          std::chrono::milliseconds(STREAM_CAPTURE_IDLE_MS),
+          [this, &type]() {
+            return !is_stream_capturing_ || IsStreamEnabled(type);
+          });
+    }
   }
 }
 
@@ -268,95 +404,53 @@ void Streams::OnImageInfoStateChanged(bool enabled, bool sync) {
   is_image_info_enabled_ = enabled;
   is_image_info_sync_ = sync;
   if (!sync) {
-    // clear queue for sync
-    for (auto&& datas : stream_queue_map_) {
-      datas.second->Clear();
-    }
-    for (auto&& infos : stream_info_queue_map_) {
-      infos.second->Clear();
+    // clear for sync
+    for (auto&& sync : stream_sync_map_) {
+      sync.second->Clear();
     }
   }
+  // sets would wait infos of the other state
+  frame_sets_.Clear();
 }
 
 void Streams::OnStreamDataStateChanged(const ImageType& type, bool enabled) {
   if (enabled) {
-    is_image_enabled_set_.insert(type);
+    {
+      std::lock_guard<std::mutex> _(stream_enabled_mutex_);
+      is_image_enabled_set_.insert(type);
+    }
+    // Wake the idle thread, not missed as it checks under the lock
+    { std::lock_guard<std::mutex> _(stream_capture_mutex_); }
+    stream_capture_condition_.notify_all();
     StartStreamCapturing();
   } else {
-    is_image_enabled_set_.erase(type);
+    {
+      std::lock_guard<std::mutex> _(stream_enabled_mutex_);
+      is_image_enabled_set_.erase(type);
+    }
     if (!HasStreamDataEnabled()) {
       StopStreamCapturing();
     }
     // clear queue
     auto&& stream_type = GetStreamType(type);
-    stream_queue_map_[stream_type]->Clear();
-    stream_info_queue_map_[stream_type]->Clear();
+    stream_sync_map_[stream_type]->Clear();
     img_data_queue_map_[type]->Clear();
+    frame_sets_.Clear();
   }
 }
 
-void Streams::SyncStreamWithInfo(bool force) {
-  if (!is_image_info_sync_) return;
-
-  // keep sync frequency
-  {
-    using clock = times::clock;
-    static clock::duration time_dist{clock::period::den / clock::period::num \
-        / IMG_INFO_SYNC_FREQUENCY};
-    static clock::time_point time_prev = times::now();
-
-    if (force) {
-      time_prev = times::now();
-    } else {
-      auto time_now = times::now();
-      if (time_now - time_prev < time_dist) {
-        time_prev = time_now;
-        // LOGI("Skip sync image info");
-        return;
-      }
-      time_prev = time_now;
-    }
-  }
-
-  for (auto&& type : all_stream_types_) {
-    if (!IsStreamEnabled(type)) continue;
-
-    auto&& streams = stream_queue_map_[type];
-    if (streams->empty()) continue;
-
-    auto&& infos = stream_info_queue_map_[type];
-    if (infos->empty()) continue;
-
-    std::lock_guard<std::mutex> _(streams->mutex());
-    std::lock_guard<std::mutex> _i(infos->mutex());
-
-    if (streams->empty() || infos->empty()) continue;
-
-    bool next = false;
-    for (auto st_it = streams->begin(); st_it != streams->end();) {
-      next = true;
-      auto frame_id = (*st_it)->frame_id();
-
-      for (auto info_it = infos->begin();
-          info_it != infos->end();) {
-        if (frame_id == (*info_it)->frame_id) {
-          OnStreamSyncedInfoCaptured(type, *st_it, *info_it);
-
-          st_it = streams->erase(st_it);
-          info_it = infos->erase(info_it);
-          next = false;
-          break;
-        }
-
-        ++info_it;
-      }
-      if (next) ++st_it;
-    }
+void Streams::SyncStreamWithInfo(const StreamType& type,
+    const CapturedImage& stream) {
+  // frame id of the stream is of the device, 16 bits as of the info
+  img_info_ptr_t info;
+  if (stream_sync_map_[type]->PutStream(stream.image->frame_id(), stream,
+      &info)) {
+    OnStreamSyncedInfoCaptured(type, stream, info);
   }
 }
 
 void Streams::OnStreamSyncedInfoCaptured(const StreamType& type,
-    const Image::pointer& stream,
+    const CapturedImage& stream,
     const img_info_ptr_t& stream_info) {
   if (type == StreamType::STREAM_COLOR) {
     DoImageColorCaptured(stream, stream_info);
@@ -367,74 +461,143 @@ void Streams::OnStreamSyncedInfoCaptured(const StreamType& type,
   }
 }
 
-void Streams::CaptureStreamColor() {
-  if (!IsStreamEnabled(STREAM_COLOR)) return;
-
+bool Streams::CaptureStreamColor() {
+  auto read_time = clock::now();
   auto color = device_->GetImageColor();
-  if (!color) return;
+  if (!color) return false;
+  auto time = clock::now();
   // LOGI("%s: %d", __func__, color->frame_id());
+  {
+    std::lock_guard<std::mutex> _(latency_mutex_);
+    auto&& stats = read_wait_map_[STREAM_COLOR];
+    ++stats.frames;
+    stats.sum_us += std::chrono::duration_cast<std::chrono::microseconds>(
+        time - read_time).count();
+  }
 
   color->set_is_dual(is_right_color_supported_);
 
-  // Ensure not buffer to user, as it may changed when captured again.
-  if (color->is_buffer()) {
-    color = color->Clone();
-  }
+  // Devices hand over a new image of the caches each frame, so no copy
 
   if (is_image_info_sync_) {
-    stream_queue_map_[STREAM_COLOR]->Put(color);
+    SyncStreamWithInfo(STREAM_COLOR, {color, time});
   } else {
-    DoImageColorCaptured(color, nullptr);
+    DoImageColorCaptured({color, time}, nullptr);
   }
+  return true;
 }
 
-void Streams::CaptureStreamDepth() {
-  if (!IsStreamEnabled(STREAM_DEPTH)) return;
-
+bool Streams::CaptureStreamDepth() {
+  auto read_time = clock::now();
   auto depth = device_->GetImageDepth();
-  if (!depth) return;
+  if (!depth) return false;
+  auto time = clock::now();
   // LOGI("%s: %d", __func__, depth->frame_id());
-
-  // Ensure not buffer to user, as it may changed when captured again.
-  if (depth->is_buffer()) {
-    depth = depth->Clone();
+  {
+    std::lock_guard<std::mutex> _(latency_mutex_);
+    auto&& stats = read_wait_map_[STREAM_DEPTH];
+    ++stats.frames;
+    stats.sum_us += std::chrono::duration_cast<std::chrono::microseconds>(
+        time - read_time).count();
   }
 
+  // Devices hand over a new image of the caches each frame, so no copy
+
   // On win, could not sync image info for depth
   if (is_image_info_sync_) {
-    stream_queue_map_[STREAM_DEPTH]->Put(depth);
+    SyncStreamWithInfo(STREAM_DEPTH, {depth, time});
   } else {
-    DoImageDepthCaptured(depth, nullptr);
+    DoImageDepthCaptured({depth, time}, nullptr);
   }
+  return true;
 }
 
-void Streams::DoImageColorCaptured(const Image::pointer& color,
+void Streams::DoImageColorCaptured(const CapturedImage& captured,
     const img_info_ptr_t& info) {
+  auto&& color = captured.image;
+  color->set_host_timestamp(host_timestamp_of(captured, info));
   if (color->is_dual()) {
     // left, right may only one or both enabled
+    // Shadow all before any callback, then they know whether share decoding
+    Image::pointer left, right;
     if (IsStreamDataEnabled(ImageType::IMAGE_LEFT_COLOR)) {
-      DoStreamDataCaptured(color->Shadow(ImageType::IMAGE_LEFT_COLOR), info);
+      left = color->Shadow(ImageType::IMAGE_LEFT_COLOR);
     }
     if (IsStreamDataEnabled(ImageType::IMAGE_RIGHT_COLOR)) {
-      DoStreamDataCaptured(color->Shadow(ImageType::IMAGE_RIGHT_COLOR), info);
+      right = color->Shadow(ImageType::IMAGE_RIGHT_COLOR);
     }
+    if (left) DoStreamDataCaptured(left, info, captured.time);
+    if (right) DoStreamDataCaptured(right, info, captured.time);
   } else /*if (left_enabled)*/ {
     // left must enabled if left only, as could not enable right if left only
-    DoStreamDataCaptured(color, info);
+    DoStreamDataCaptured(color, info, captured.time);
   }
 }
 
-void Streams::DoImageDepthCaptured(const Image::pointer& depth,
+void Streams::DoImageDepthCaptured(const CapturedImage& captured,
     const img_info_ptr_t& info) {
-  DoStreamDataCaptured(depth, info);
+  captured.image->set_host_timestamp(host_timestamp_of(captured, info));
+  DoStreamDataCaptured(captured.image, info, captured.time);
 }
 
 void Streams::DoStreamDataCaptured(const Image::pointer& image,
-    const img_info_ptr_t& info) {
+    const img_info_ptr_t& info, const clock::time_point& captured_time) {
   auto&& type = image->type();
-  StreamData data{image, info};
+  StreamData data{image, info, {}};
+  if (info) {
+    // put from the capture or the info thread, so swap the from under lock
+    std::uint64_t from;
+    motion_datas_getter_t getter;
+    preintegration_getter_t preintegration_getter;
+    {
+      std::lock_guard<std::mutex> _(motion_datas_getter_mutex_);
+      getter = motion_datas_getter_;
+      preintegration_getter = preintegration_getter_;
+      auto&& last = motion_datas_from_map_[type];
+      from = last;
+      last = info->device_timestamp;
+    }
+    // none of the first frame, as not known since when
+    if (getter && from > 0) {
+      data.motion_datas = getter(from, info->device_timestamp);
+    }
+    if (preintegration_getter) {
+      data.preintegration = preintegration_getter(info->device_timestamp);
+    }
+  }
   img_data_queue_map_[type]->Put(data);
   if (img_data_callbacks_[type]) {
     img_data_callbacks_[type](data);
   }
+
+  // right only if supported, otherwise it never comes
+  std::set<ImageType> required;
+  {
+    std::lock_guard<std::mutex> _(stream_enabled_mutex_);
+    required = is_image_enabled_set_;
+  }
+  if (!is_right_color_supported_) {
+    required.erase(ImageType::IMAGE_RIGHT_COLOR);
+  }
+  frame_sets_.Put(type, data, required);
+
+  std::uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          clock::now() - captured_time).count();
+  std::lock_guard<std::mutex> _(latency_mutex_);
+  auto&& stats = latency_map_[type];
+  ++stats.frames;
+  stats.sum_us += latency_us;
+  stats.max_us = std::max(stats.max_us, latency_us);
+}
+
+void Streams::ResetStreamLatency() {
+  {
+    std::lock_guard<std::mutex> _(latency_mutex_);
+    latency_map_.clear();
+    read_wait_map_.clear();
+  }
+  for (auto&& sync : stream_sync_map_) {
+    sync.second->ResetStats();
+  }
 }
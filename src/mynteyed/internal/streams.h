@@ -15,16 +15,21 @@
 #define MYNTEYE_INTERNAL_STREAMS_H_
 #pragma once
 
-// #include <atomic>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <set>
 #include <thread>
 #include <vector>
 
 #include "mynteyed/data/types_internal.h"
 #include "mynteyed/internal/blocking_queue.h"
+#include "mynteyed/internal/frame_sets.h"
+#include "mynteyed/internal/frame_sync.h"
 #include "mynteyed/types.h"
 
 MYNTEYE_BEGIN_NAMESPACE
@@ -44,14 +49,16 @@ class Streams {
   using img_data_queue_t = queue_t<img_data_t>;
   using img_data_queue_ptr_t = std::shared_ptr<img_data_queue_t>;
 
-  // img infos
-  using img_info_queue_t = queue_t<img_info_ptr_t>;
-  using img_info_queue_ptr_t = std::shared_ptr<img_info_queue_t>;
-
   // img data callback
   using img_data_callback_t = std::function<void(const img_data_t& data)>;
   // img info callback
   using img_info_callback_t = std::function<void(const img_info_ptr_t& info)>;
+  // motion datas after from till to, by the timestamps
+  using motion_datas_getter_t = std::function<std::vector<MotionData>(
+      std::uint64_t from, std::uint64_t to)>;
+  // preintegration till to, nullptr if none
+  using preintegration_getter_t =
+      std::function<std::shared_ptr<ImuPreintegration>(std::uint64_t to)>;
 
   // stream types
   typedef enum StreamType {
@@ -59,9 +66,16 @@ class Streams {
     STREAM_DEPTH,  // depth
   } stream_type_t;
 
-  // stream queue
-  using stream_queue_t = queue_t<Image::pointer>;
-  using stream_queue_ptr_t = std::shared_ptr<stream_queue_t>;
+  // captured image, with the time read off the device
+  using clock = std::chrono::steady_clock;
+  struct CapturedImage {
+    Image::pointer image;
+    clock::time_point time;
+  };
+
+  // stream sync with infos
+  using stream_sync_t = FrameSync<CapturedImage, img_info_ptr_t>;
+  using stream_sync_ptr_t = std::shared_ptr<stream_sync_t>;
 
   explicit Streams(std::shared_ptr<Device> device);
   ~Streams();
@@ -100,6 +114,19 @@ class Streams {
 
   void SetStreamCallback(const ImageType& type, img_data_callback_t callback);
 
+  // Gets the motion datas of each stream data if set, nullptr not
+  void SetMotionDatasGetter(motion_datas_getter_t getter);
+  // Gets the preintegration of each stream data if set, nullptr not
+  void SetPreintegrationGetter(preintegration_getter_t getter);
+
+  void SetFrameSetOptions(const FrameSetOptions& options);
+  // Latest frame set of the stream datas enabled, blocks until one
+  FrameSet GetFrameSet();
+  void SetFrameSetCallback(FrameSets::frameset_callback_t callback);
+
+  StreamLatency GetStreamLatency(const ImageType& type) const;
+  StreamSyncStats GetStreamSyncStats(const ImageType& type) const;
+
   void OnCameraOpen();
   void OnCameraClose();
 
@@ -121,25 +148,31 @@ class Streams {
 
   void StartStreamCapturing();
   void StopStreamCapturing();
+  // Captures the stream on the calling thread until stopped
+  void RunStreamCapturing(const StreamType& type);
 
   void OnImageInfoStateChanged(bool enabled, bool sync);
   void OnStreamDataStateChanged(const ImageType& type, bool enabled);
 
-  void SyncStreamWithInfo(bool force);
+  // Syncs the stream with its info, captures them if matched
+  void SyncStreamWithInfo(const StreamType& type, const CapturedImage& stream);
   void OnStreamSyncedInfoCaptured(const StreamType& type,
-      const Image::pointer& stream,
+      const CapturedImage& stream,
       const img_info_ptr_t& stream_info);
 
-  void CaptureStreamColor();
-  void CaptureStreamDepth();
+  // false if failed to read the device
+  bool CaptureStreamColor();
+  bool CaptureStreamDepth();
 
-  void DoImageColorCaptured(const Image::pointer& color,
+  void DoImageColorCaptured(const CapturedImage& color,
       const img_info_ptr_t& info);
-  void DoImageDepthCaptured(const Image::pointer& depth,
+  void DoImageDepthCaptured(const CapturedImage& depth,
       const img_info_ptr_t& info);
 
   void DoStreamDataCaptured(const Image::pointer& image,
-      const img_info_ptr_t& info);
+      const img_info_ptr_t& info, const clock::time_point& captured_time);
+
+  void ResetStreamLatency();
 
   std::shared_ptr<Device> device_;
 
@@ -152,20 +185,44 @@ class Streams {
   bool is_right_color_supported_;
 
   std::set<ImageType> is_image_enabled_set_;
+  mutable std::mutex stream_enabled_mutex_;
 
   std::size_t stream_datas_max_size_;
 
-  bool is_stream_capturing_;
-  std::thread stream_capture_thread_;
-
-  // stream queue, only for sync
-  std::map<stream_type_t, stream_queue_ptr_t> stream_queue_map_;
-  // stream info queue, only for sync
-  std::map<stream_type_t, img_info_queue_ptr_t> stream_info_queue_map_;
+  // One thread each stream, blocks reading the device
+  std::atomic<bool> is_stream_capturing_;
+  std::map<stream_type_t, std::thread> stream_capture_threads_;
+  // Wakes the threads idle or retrying, if enabled or stopped
+  std::mutex stream_capture_mutex_;
+  std::condition_variable stream_capture_condition_;
+
+  struct LatencyStats {
+    std::uint64_t frames = 0;
+    std::uint64_t sum_us = 0;
+    std::uint64_t max_us = 0;
+  };
+  // read off the device to delivered, of each image type
+  std::map<ImageType, LatencyStats> latency_map_;
+  // blocked reading the device, of each stream type
+  std::map<stream_type_t, LatencyStats> read_wait_map_;
+  mutable std::mutex latency_mutex_;
+
+  // stream sync, only for sync
+  std::map<stream_type_t, stream_sync_ptr_t> stream_sync_map_;
 
   // img data queue
   std::map<ImageType, img_data_queue_ptr_t> img_data_queue_map_;
 
+  // frame sets of the stream datas enabled
+  FrameSets frame_sets_;
+
+  motion_datas_getter_t motion_datas_getter_;
+  preintegration_getter_t preintegration_getter_;
+  // Guards the getters above, and the froms below
+  std::mutex motion_datas_getter_mutex_;
+  // timestamp of the previous frame of each image type, 0 if none
+  std::map<ImageType, std::uint64_t> motion_datas_from_map_;
+
   img_info_callback_t img_info_callback_;
   std::map<ImageType, img_data_callback_t> img_data_callbacks_;
 };
@@ -0,0 +1,93 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_UTIL_SPSC_RING_H_
+#define MYNTEYE_UTIL_SPSC_RING_H_
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+/**
+ * Bounded lock-free queue of one producer thread and one consumer thread.
+ *
+ * Items are slots filled and read in place, so reused without allocating.
+ * The producer never waits: it gets no slot if full.
+ */
+template <typename T>
+class SpscRing {
+ public:
+  using size_type = std::size_t;
+
+  explicit SpscRing(size_type capacity)
+    : items_(capacity > 0 ? capacity + 1 : 2), head_(0), tail_(0) {}
+
+  size_type capacity() const { return items_.size() - 1; }
+  // Exact only on the producer or consumer thread
+  size_type size() const {
+    size_type head = head_.load(std::memory_order_acquire);
+    size_type tail = tail_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : tail + items_.size() - head;
+  }
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+        tail_.load(std::memory_order_acquire);
+  }
+
+  // Producer: the slot to fill, nullptr if full. Then push it.
+  T* back() {
+    size_type tail = tail_.load(std::memory_order_relaxed);
+    if (Next(tail) == head_.load(std::memory_order_acquire)) return nullptr;
+    return &items_[tail];
+  }
+  void push_back() {
+    size_type tail = tail_.load(std::memory_order_relaxed);
+    tail_.store(Next(tail), std::memory_order_release);
+  }
+
+  // Consumer: the oldest slot, nullptr if empty. Then pop it.
+  T* front() {
+    size_type head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+    return &items_[head];
+  }
+  void pop_front() {
+    size_type head = head_.load(std::memory_order_relaxed);
+    head_.store(Next(head), std::memory_order_release);
+  }
+
+ private:
+  size_type Next(size_type i) const {
+    ++i;
+    return i < items_.size() ? i : 0;
+  }
+
+  // One slot kept empty, to tell full from empty
+  std::vector<T> items_;
+  // Written by the consumer only
+  std::atomic<size_type> head_;
+  // Written by the producer only
+  std::atomic<size_type> tail_;
+
+  MYNTEYE_DISABLE_COPY(SpscRing)
+  MYNTEYE_DISABLE_MOVE(SpscRing)
+};
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_UTIL_SPSC_RING_H_
@@ -0,0 +1,62 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mynteyed/util/threads.h"
+
+#if defined(MYNTEYE_OS_WIN)
+#include <Windows.h>
+#elif defined(MYNTEYE_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace threads {
+
+bool set_affinity(int cpu) {
+  if (cpu < 0) return false;
+#if defined(MYNTEYE_OS_WIN)
+  if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+  DWORD_PTR mask = static_cast<DWORD_PTR>(1) << cpu;
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(MYNTEYE_OS_LINUX)
+  if (cpu >= CPU_SETSIZE) return false;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+  return false;
+#endif
+}
+
+bool set_high_priority() {
+#if defined(MYNTEYE_OS_WIN)
+  return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST) != 0;
+#elif defined(MYNTEYE_OS_LINUX)
+  // The middle of the range, over normal threads but under the critical ones
+  int min = sched_get_priority_min(SCHED_FIFO);
+  int max = sched_get_priority_max(SCHED_FIFO);
+  if (min < 0 || max < 0) return false;
+  sched_param param;
+  param.sched_priority = (min + max) / 2;
+  return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace threads
+
+MYNTEYE_END_NAMESPACE
@@ -0,0 +1,36 @@
+// Copyright 2018 Slightech Co., Ltd. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MYNTEYE_UTIL_THREADS_H_
+#define MYNTEYE_UTIL_THREADS_H_
+#pragma once
+
+#include "mynteyed/stubs/global.h"
+
+MYNTEYE_BEGIN_NAMESPACE
+
+namespace threads {
+
+// Pins the calling thread to the cpu, index from 0. false if failed or not
+// supported.
+bool set_affinity(int cpu);
+
+// Raises the calling thread over the normal ones, real-time on linux which
+// needs the privilege. false if failed or not supported.
+bool set_high_priority();
+
+}  // namespace threads
+
+MYNTEYE_END_NAMESPACE
+
+#endif  // MYNTEYE_UTIL_THREADS_H_
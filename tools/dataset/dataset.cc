@@ -63,7 +63,8 @@ void Dataset::SaveMotionData(const MYNTEYE_NAMESPACE::MotionData &data) {
     << (double)data.imu->timestamp/100000.0 << ", "<< data.imu->accel[0] << ", "
     << data.imu->accel[1] << ", " << data.imu->accel[2] << ", "
     << data.imu->gyro[0] << ", " << data.imu->gyro[1] << ", "
-    << data.imu->gyro[2] << ", " << data.imu->temperature << std::endl;
+    << data.imu->gyro[2] << ", " << data.imu->temperature << ", "
+    << std::setprecision(9) << data.imu->host_timestamp / 1e9 << std::endl;
   ++motion_count_;
 }
 
@@ -84,8 +85,10 @@ void Dataset::SaveStreamData(const ImageType &type,
           } else {
               writer->ofs << seq << ", " << data.img_info->frame_id << ", "
                           << std::setiosflags(std::ios::fixed) << std::setprecision(5)
-                          << (double)data.img_info->timestamp /100000.0 << ", "
-                          << data.img_info->exposure_time << std::endl;
+                          << (double)data.img_info->device_timestamp /100000.0 << ", "
+                          << data.img_info->exposure_time << ", "
+                          << std::setprecision(9)
+                          << data.img_info->host_timestamp / 1e9 << std::endl;
           }
 
 
@@ -121,7 +124,8 @@ Dataset::writer_t Dataset::GetMotionWriter() {
     writer->ofs.open(writer->outfile, std::ofstream::out);
     writer->ofs << "seq, flag, timestamp, "
                    "accel_x, accel_y, accel_z, "
-                   "gyro_x, gyro_y, gyro_z, temperature" << std::endl;
+                   "gyro_x, gyro_y, gyro_z, temperature, host_timestamp"
+                << std::endl;
     writer->ofs << FULL_PRECISION;
 
     motion_writer_ = writer;
@@ -158,7 +162,8 @@ Dataset::writer_t Dataset::GetStreamWriter(const ImageType &type) {
     files::mkdir(writer->outdir);
     writer->ofs.open(writer->outfile, std::ofstream::out);
       if(type != ImageType::IMAGE_DEPTH) {
-          writer->ofs << "seq, frame_id, timestamp, exposure_time" << std::endl;
+          writer->ofs << "seq, frame_id, timestamp, exposure_time, "
+                         "host_timestamp" << std::endl;
       }
 //    writer->ofs << "seq, frame_id, timestamp, exposure_time" << std::endl;
     writer->ofs << FULL_PRECISION;
@@ -488,7 +488,10 @@ class MYNTEYEWrapperNodelet : public nodelet::Nodelet {
     auto timestamp = data.img_info
         ? hardTimeToSoftTime(data.img_info->timestamp)
         : ros::Time().now();
-    auto&& mat = data.img->To(ImageFormat::COLOR_RGB)->ToMat();
+    cv::Mat mat;
+    if (color_sub || (is_left && sub_result.points)) {
+      mat = data.img->To(ImageFormat::COLOR_RGB)->ToMat();
+    }
 
     if (color_sub) {
       std_msgs::Header header;
@@ -506,8 +509,8 @@ class MYNTEYEWrapperNodelet : public nodelet::Nodelet {
       header.stamp = timestamp;
       header.frame_id = mono_frame_id;
 
-      cv::Mat dst;
-      cv::cvtColor(mat, dst, CV_RGB2GRAY);
+      // Luma from the raw stream directly, without rgb in between
+      auto&& dst = data.img->To(ImageFormat::COLOR_GRAY)->ToMat();
       auto&& msg = cv_bridge::CvImage(header, enc::MONO8, dst).toImageMsg();
       if (info) info->header.stamp = msg->header.stamp;
       pub_mono.publish(msg, info);